@@ -20,63 +20,13 @@
 // <https://github.com/LittleBuster>
 
 
+#ifndef CHARS_H
+#define CHARS_H
+
 #include <avr/pgmspace.h>
+#include <stdint.h>
 
-const uint8_t CHARSET[][5] PROGMEM = {
-	{ 0x00, 0x00, 0x00, 0x00, 0x00 }, // 20 space
-	{ 0xff, 0xC1, 0xD5, 0xC1, 0xfe }, // 21 ! - fuel distributor symbol 1/2
-	{ 0x0c, 0x02, 0x00, 0x00, 0x00 }, // 22 " - fuel distributor symbol 2/2
-	{ 0x5c, 0x22, 0x2a, 0x22, 0x1d }, // 23 # - instat fuel consumption symbol
-	{ 0x3e, 0xc1, 0xc9, 0xc9, 0x3e }, // 24 $ - range symbol 1/3
-	{ 0x08, 0x08, 0x08, 0x08, 0x08 }, // 25 % - range symbol 2/3
-	{ 0x49, 0x2a, 0x1c, 0x08, 0x00 }, // 26 & - range symbol 3/3
-	{ 0x00, 0x05, 0x03, 0x00, 0x00 }, // 27 '
-	{ 0x00, 0x1c, 0x22, 0x41, 0x00 }, // 28 (
-	{ 0x00, 0x41, 0x22, 0x1c, 0x00 }, // 29 )
-	{ 0x00, 0x00, 0x02, 0x05, 0x02 }, // 2a * - degree symbol (°)
-	{ 0x08, 0x08, 0x3e, 0x08, 0x08 }, // 2b +
-	{ 0x00, 0x50, 0x30, 0x00, 0x00 }, // 2c ,
-    
-	{ 0x08, 0x08, 0x08, 0x08, 0x08 }, // 2d -
-	{ 0x00, 0x60, 0x60, 0x00, 0x00 }, // 2e .
-	{ 0x20, 0x10, 0x08, 0x04, 0x02 }, // 2f /
-	{ 0x3e, 0x51, 0x49, 0x45, 0x3e }, // 30 0
-	{ 0x00, 0x42, 0x7f, 0x40, 0x00 }, // 31 1
-	{ 0x42, 0x61, 0x51, 0x49, 0x46 }, // 32 2
-	{ 0x21, 0x41, 0x45, 0x4b, 0x31 }, // 33 3
-	{ 0x18, 0x14, 0x12, 0x7f, 0x10 }, // 34 4
-	{ 0x27, 0x45, 0x45, 0x45, 0x39 }, // 35 5
-	{ 0x3c, 0x4a, 0x49, 0x49, 0x30 }, // 36 6
-	{ 0x01, 0x71, 0x09, 0x05, 0x03 }, // 37 7
-	{ 0x36, 0x49, 0x49, 0x49, 0x36 }, // 38 8
-	{ 0x06, 0x49, 0x49, 0x29, 0x1e }, // 39 9
-	{}, {}, {}, {}, {}, {}, {},       // It doesn't take less space, just looks cleaner
-	{ 0x7e, 0x11, 0x11, 0x11, 0x7e }, // 41 A
-	{ 0x7f, 0x49, 0x49, 0x49, 0x36 }, // 42 B
-	{ 0x3e, 0x41, 0x41, 0x41, 0x22 }, // 43 C
-	{ 0x7f, 0x41, 0x41, 0x22, 0x1c }, // 44 D
-	{ 0x7f, 0x49, 0x49, 0x49, 0x41 }, // 45 E
-	{ 0x7f, 0x09, 0x09, 0x09, 0x01 }, // 46 F
-	{ 0x3e, 0x41, 0x49, 0x49, 0x7a }, // 47 G
-	{ 0x7f, 0x08, 0x08, 0x08, 0x7f }, // 48 H
-	{ 0x00, 0x41, 0x7f, 0x41, 0x00 }, // 49 I
-	{ 0x20, 0x40, 0x41, 0x3f, 0x01 }, // 4a J
-	{ 0x7f, 0x08, 0x14, 0x22, 0x41 }, // 4b K
-	{ 0x7f, 0x40, 0x40, 0x40, 0x40 }, // 4c L
-	{ 0x7f, 0x02, 0x0c, 0x02, 0x7f }, // 4d M
-	{ 0x7f, 0x04, 0x08, 0x10, 0x7f }, // 4e N
-	{ 0x3e, 0x41, 0x41, 0x41, 0x3e }, // 4f O
-	{ 0x7f, 0x09, 0x09, 0x09, 0x06 }, // 50 P
-	{ 0x3e, 0x41, 0x51, 0x21, 0x5e }, // 51 Q
-	{ 0x7f, 0x09, 0x19, 0x29, 0x46 }, // 52 R
-	{ 0x46, 0x49, 0x49, 0x49, 0x31 }, // 53 S
-	{ 0x01, 0x01, 0x7f, 0x01, 0x01 }, // 54 T
-	{ 0x3f, 0x40, 0x40, 0x40, 0x3f }, // 55 U
-	{ 0x1f, 0x20, 0x40, 0x20, 0x1f }, // 56 V
-	{ 0x3f, 0x40, 0x38, 0x40, 0x3f }, // 57 W
-	{ 0x63, 0x14, 0x08, 0x14, 0x63 }, // 58 X
-	{ 0x07, 0x08, 0x70, 0x08, 0x07 }, // 59 Y
-	{ 0x61, 0x51, 0x49, 0x45, 0x43 }, // 5a Z
-	{ 0x00, 0x00, 0x00, 0x00, 0x00 }  // 7f
+// 5x7 font, columns with the top row in bit 0 - starts at ' ' (0x20)
+extern const uint8_t CHARSET[][5] PROGMEM;
 
-};
\ No newline at end of file
+#endif  // CHARS_H
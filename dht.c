@@ -0,0 +1,71 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#include <avr/interrupt.h>
+#include "dht.h"
+
+volatile uint8_t dhtDelta[DHT_EDGES];
+volatile uint8_t dhtEdges = 0, dhtLast = 0;
+
+
+// Start signal - the line has to be held low for at least 18 ms
+void dhtStart(void) {
+    PCMSK2 &= ~DHT_PCINT;
+    DHT_EN_OUT;
+    DHT_LO;
+}
+
+// Releases the line and lets the pin change interrupt collect the sensor's answer
+void dhtListen(void) {
+    cli();
+    dhtEdges = 0;
+    dhtLast = TCNT0;
+    sei();
+
+    DHT_EN_INP;
+    PCMSK2 |= DHT_PCINT;
+}
+
+// Decodes the collected frame, returns 0 if it's incomplete or the checksum doesn't match
+uint8_t dhtDecode(DHT *dht) {
+    uint8_t data[5] = {0, 0, 0, 0, 0};
+    register uint8_t i, n;
+
+    PCMSK2 &= ~DHT_PCINT;
+
+    // The last 40 intervals are the bits - anything before them is the response or a glitch
+    n = dhtEdges;
+    if(n < 40) return 0;
+
+    for(i = 0; i != 40; ++i) {
+        data[i/8] <<= 1;
+        if(dhtDelta[n - 40 + i] > DHT_BIT_TICKS) data[i/8] |= 1;
+    }
+
+    if(data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) return 0;
+
+    // DHT11 sends integral and decimal parts in separate bytes
+    dht->humidity = data[0] + (float)data[1] / 10;
+
+    dht->temperature = (data[2] & 0x7F) + (float)data[3] / 10;
+    if(data[2] & 0x80) dht->temperature = -dht->temperature;
+
+    return 1;
+}
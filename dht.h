@@ -0,0 +1,65 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#ifndef DHT_H
+#define DHT_H
+
+#include <avr/io.h>
+#include <stdint.h>
+#include "millis.h"
+
+#define DHT_DDR  DDRD          
+#define DHT_PORT PORTD
+#define DHT_PIN  (1<<5)                    // PD5 as DHT11 pin
+#define DHT_PCINT (1<<PCINT21)             // Its pin change interrupt, in PCMSK2
+
+#define DHT_EN_OUT  DHT_DDR |= DHT_PIN     // PD5 as output
+#define DHT_EN_INP  DHT_DDR &= ~DHT_PIN    // PD5 as input
+
+#define DHT_LO   DHT_PORT &= ~DHT_PIN      // Low state on PD5
+#define DHT_HI   DHT_PORT |= DHT_PIN       // High state on PD5
+
+// Bits are told apart by the time between falling edges: ~78us for 0, ~120us for 1
+#define DHT_EDGES     48                   // Response, 40 bits and some spare
+#define DHT_BIT_TICKS US_TO_TICKS(100)        // 100us in TIMER0 ticks
+
+typedef struct {
+    float humidity;
+    float temperature;
+} DHT;
+
+// Filled by `dhtEdge()` from the pin change interrupt - TIMER0 ticks between falling edges
+extern volatile uint8_t dhtDelta[DHT_EDGES];
+extern volatile uint8_t dhtEdges, dhtLast;
+
+// Call from the ISR on a falling edge of the DHT pin - only the low byte of TIMER0 is needed,
+// as no interval of the frame is longer than 256 ticks
+__attribute__((always_inline)) static inline void dhtEdge(void) {
+    uint8_t t = TCNT0;
+
+    if(dhtEdges < DHT_EDGES) dhtDelta[dhtEdges++] = t - dhtLast;
+    dhtLast = t;
+}
+
+void dhtStart(void);
+void dhtListen(void);
+uint8_t dhtDecode(DHT *dht);
+
+#endif  // DHT_H
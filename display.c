@@ -0,0 +1,116 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#include "display.h"
+
+#include <avr/pgmspace.h>
+#include <stdlib.h>
+
+#include "chars.h"
+
+
+// Glyph rows are stored in bits 0-6 of every column, bit 7 is never drawn
+#define GLYPH_MASK 0x7F
+
+// Backends shift a column by up to 7 rows inside 32 bits, so taller ones go in two parts
+#define COLUMN_ROWS 25
+#define COLUMN_SPLIT 16
+
+static struct {
+    uint8_t cursorX;
+    uint8_t cursorY;
+} text = {
+    .cursorX = 0,
+    .cursorY = 0
+};
+
+// Every bit of a nibble doubled - used to stretch glyph columns for scale 2
+static const uint8_t DOUBLE_NIBBLE[16] PROGMEM = {
+    0x00, 0x03, 0x0C, 0x0F, 0x30, 0x33, 0x3C, 0x3F,
+    0xC0, 0xC3, 0xCC, 0xCF, 0xF0, 0xF3, 0xFC, 0xFF
+};
+
+
+__attribute__((always_inline)) static inline uint32_t stretchColumn(uint8_t column, const uint8_t scale) {
+    register uint8_t i;
+    uint32_t bits = 0;
+
+    if(scale == 1) return column;
+    if(scale == 2) return pgm_read_byte(&DOUBLE_NIBBLE[column & 0x0F]) | ((uint16_t)pgm_read_byte(&DOUBLE_NIBBLE[column >> 4]) << 8);
+
+    // Any other scale, up to 4 so the column fits in 32 bits
+    for(i = 0; i != 7; ++i)
+        if(column & (1<<i)) bits |= ((1UL<<scale) - 1) << (i*scale);
+    return bits;
+}
+
+// Body of every specialised renderer - with constant `scale` all divisions and branches fold away
+__attribute__((always_inline)) static inline void drawChar(char code, const uint8_t scale) {
+    register uint8_t i, s;
+    register uint8_t x = text.cursorX;
+    const uint8_t *glyph = CHARSET[code-32];
+    uint32_t bits;
+
+    for(i = 0; i != 5; ++i) {
+        bits = stretchColumn(pgm_read_byte(&glyph[i]) & GLYPH_MASK, scale);
+        for(s = 0; s != scale; ++s, ++x) {
+            if(x >= DISPLAY_WIDTH) continue;
+            if(7*scale <= COLUMN_ROWS) displayColumn(x, text.cursorY, bits, 7*scale);
+            else {
+                displayColumn(x, text.cursorY, bits, COLUMN_SPLIT);
+                displayColumn(x, text.cursorY + COLUMN_SPLIT, bits >> COLUMN_SPLIT, 7*scale - COLUMN_SPLIT);
+            }
+        }
+    }
+
+    text.cursorX += 5*scale + 1;
+    if(text.cursorX >= DISPLAY_WIDTH) {
+        text.cursorX = 0;
+        text.cursorY += 7*scale + 1;
+    } 
+    
+    if(text.cursorY >= DISPLAY_HEIGHT) {
+        text.cursorX = 0;
+        text.cursorY = 0;
+    }
+}
+
+
+void displayCursor(uint8_t x, uint8_t y) {
+    text.cursorX = x;
+    text.cursorY = y;
+}
+
+void displayChar1(char code) {drawChar(code, 1);}
+void displayChar2(char code) {drawChar(code, 2);}
+void displayCharN(char code, uint8_t scale) {
+    if(scale == 1) displayChar1(code);
+    else if(scale == 2) displayChar2(code);
+    else drawChar(code, scale > 4 ? 4 : scale);  // Taller columns don't fit in 32 bits
+}
+
+void displayText1(const char *str) {while(*str) displayChar1(*str++);}
+void displayText2(const char *str) {while(*str) displayChar2(*str++);}
+void displayTextN(const char *str, uint8_t scale) {while(*str) displayCharN(*str++, scale);}
+
+void displayNumber(long value, uint8_t scale) {
+    char buffer[12];
+    displayTextN(ltoa(value, buffer, 10), scale);
+}
@@ -0,0 +1,127 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stdint.h>
+
+// Exactly one backend has to be selected - the others, and their buffers, are compiled out
+#ifndef USE_PCD8544
+    #define USE_PCD8544      1        // 1 - use PCD8544 LCD screen;   0 - don't use PCD8544 LCD screen
+#endif
+#ifndef USE_SSD1327
+    #define USE_SSD1327      0        // 1 - use SSD1327 OLED screen;  0 - don't use SSD1327 OLED screen
+#endif
+#ifndef USE_DISPLAY_MOCK
+    #define USE_DISPLAY_MOCK 0        // 1 - use in-memory display, for host builds
+#endif
+
+#if USE_PCD8544 + USE_SSD1327 + USE_DISPLAY_MOCK != 1
+    #error "Select exactly one display backend"
+#endif
+
+
+// Backend primitives - every call below is resolved at compile time
+#if USE_PCD8544 == 1
+    #include "lcd.h"
+
+    #define DISPLAY_WIDTH   LCD_WIDTH
+    #define DISPLAY_HEIGHT  (LCD_BANKS*8)
+    #define DISPLAY_PARTIAL 1         // Frame is kept between draws, so only changes have to be drawn
+
+    static inline void displayInit(void) {screenLCDInit();}
+    static inline void displayClear(void) {screenLCDClear();}
+    static inline void displayColumn(uint8_t x, uint8_t y, uint32_t bits, uint8_t height) {screenLCDColumn(x, y, bits, height);}
+    static inline void displayBackground(const uint8_t *bitmap) {screenLCDBackground(bitmap);}
+    static inline void displayRestore(const uint8_t *bitmap, uint8_t x, uint8_t y, uint8_t width, uint8_t height) {screenLCDRestore(bitmap, x, y, width, height);}
+    static inline void displayDraw(void (*draw)(void)) {draw();}
+    static inline void displayMark(uint8_t x, uint8_t y, uint8_t width, uint8_t height) {}  // Changed bytes are found as they're written
+    static inline uint8_t  displaySwap(void) {return screenLCDSwap();}
+    static inline uint16_t displaySent(void) {return screenLCDSent();}
+    static inline uint32_t displayCycles(void) {return screenLCDCycles();}
+
+#elif USE_SSD1327 == 1
+    #include "oled.h"
+
+    #define DISPLAY_WIDTH   SSD1327_WIDTH
+    #define DISPLAY_HEIGHT  SSD1327_HEIGTH
+    #define DISPLAY_PARTIAL 0         // Strips are drawn from scratch, the whole scene every time
+
+    static inline void displayInit(void) {oledInit(SSD1327_SWITCHCAPVCC, REFRESH_MID);}
+    static inline void displayClear(void) {oledClear(SSD1327_BLACK);}
+    static inline void displayColumn(uint8_t x, uint8_t y, uint32_t bits, uint8_t height) {oledColumn(x, y, bits, height, SSD1327_WHITE);}
+    static inline void displayBackground(const uint8_t *bitmap) {oledBitmap(bitmap, 0, 0, 84, 48, SSD1327_WHITE);}
+    static inline void displayRestore(const uint8_t *bitmap, uint8_t x, uint8_t y, uint8_t width, uint8_t height) {oledBitmap(bitmap, x, y, width, height, SSD1327_WHITE);}
+    static inline void displayDraw(void (*draw)(void)) {oledRender(draw);}
+    static inline void displayMark(uint8_t x, uint8_t y, uint8_t width, uint8_t height) {oledMark(x, y, width, height);}
+    static inline uint8_t  displaySwap(void) {return 1;}
+    static inline uint16_t displaySent(void) {return oledSent();}
+    static inline uint32_t displayCycles(void) {return 0;}
+
+#elif USE_DISPLAY_MOCK == 1
+    #include "mock.h"
+
+    #define DISPLAY_WIDTH   MOCK_WIDTH
+    #define DISPLAY_HEIGHT  MOCK_HEIGHT
+    #define DISPLAY_PARTIAL 1
+
+    static inline void displayInit(void) {mockClear();}
+    static inline void displayClear(void) {mockClear();}
+    static inline void displayColumn(uint8_t x, uint8_t y, uint32_t bits, uint8_t height) {mockColumn(x, y, bits, height);}
+    static inline void displayBackground(const uint8_t *bitmap) {mockBackground(bitmap);}
+    static inline void displayRestore(const uint8_t *bitmap, uint8_t x, uint8_t y, uint8_t width, uint8_t height) {mockRestore(bitmap, x, y, width, height);}
+    static inline void displayDraw(void (*draw)(void)) {draw();}
+    static inline void displayMark(uint8_t x, uint8_t y, uint8_t width, uint8_t height) {}
+    static inline uint8_t  displaySwap(void) {return mockSwap();}
+    static inline uint16_t displaySent(void) {return 0;}
+    static inline uint32_t displayCycles(void) {return 0;}
+#endif
+
+
+// Text, numbers and icons - shared by all backends
+void displayCursor(uint8_t x, uint8_t y);
+
+void displayChar1(char code);
+void displayChar2(char code);
+void displayCharN(char code, uint8_t scale);
+void displayText1(const char *str);
+void displayText2(const char *str);
+void displayTextN(const char *str, uint8_t scale);
+
+// Constant scales go straight to their specialised renderer
+__attribute__((always_inline)) static inline void displayChar(char code, uint8_t scale) {
+    if(__builtin_constant_p(scale) && scale == 1) displayChar1(code);
+    else if(__builtin_constant_p(scale) && scale == 2) displayChar2(code);
+    else displayCharN(code, scale);
+}
+
+__attribute__((always_inline)) static inline void displayText(const char *str, uint8_t scale) {
+    if(__builtin_constant_p(scale) && scale == 1) displayText1(str);
+    else if(__builtin_constant_p(scale) && scale == 2) displayText2(str);
+    else displayTextN(str, scale);
+}
+
+void displayNumber(long value, uint8_t scale);
+
+// Icons are glyphs of CHARSET outside of plain text, e.g. "$%&" for range
+static inline void displayIcon(const char *icon) {displayText1(icon);}
+
+#endif  // DISPLAY_H
@@ -18,52 +18,52 @@
 // <https://itcrowd.net.pl/>
 
 
-#include <math.h>
+#include <avr/pgmspace.h>
 #include "ftoa.h"
 
-// Reverses a string 'str' of length 'len' 
-void reverse(char* str, int len) { 
-    int i = 0, j = len-1, temp = 0; 
-    while(i < j) { 
-        temp = str[i]; 
-        str[i] = str[j]; 
-        str[j] = temp; 
-        i++; 
-        j--; 
-    } 
-} 
-  
-int intToStr(int x, char str[], int d) { 
-    int i = 0; 
-    while(x) { 
-        str[i++] = (x % 10) + '0'; 
-        x = x / 10; 
-    } 
-  
-    // If number of digits required is more, then 
-    // Add 0s at the beginning 
-    while(i < d) str[i++] = '0'; 
-  
-    reverse(str, i); 
-    str[i] = '\0'; 
-    return i; 
-} 
+static const unsigned long POW10[] PROGMEM = {
+    1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 
+    1000000UL, 10000000UL, 100000000UL, 1000000000UL
+};
 
-  
-// Converts a floating-point/double number to a string. 
-void ftoa(float n, char* res, int afterpoint) { 
-    int ipart = (int)n; 
-    float fpart = n - (float)ipart;  
-    int i = intToStr(ipart, res, 0); 
 
-    if(afterpoint != 0) { 
-        res[i] = '.';  // Add dot 
-        fpart = fpart * pow(10, afterpoint); 
-        intToStr((int)fpart, res + i + 1, afterpoint); 
-    } 
-} 
+// Converts a fixed-point number to a string.
+char *fixtoa(long value, uint8_t scale, uint8_t decimals, uint8_t width, char *res) {
+    char digits[12];
+    register uint8_t n = 0, i = 0, len;
+    unsigned long v = (value < 0) ? -(unsigned long)value : (unsigned long)value;
+    unsigned long div;
+    uint8_t negative;
+
+    // Round away digits that aren't printed in one step - rounding digit by digit would round twice
+    if(scale > decimals) {
+        div = pgm_read_dword(&POW10[scale - decimals]);
+        v = (v + div/2) / div;
+    } else if(decimals > scale) v *= pgm_read_dword(&POW10[decimals - scale]);
+
+    negative = (value < 0 && v);  // No "-0.0"
 
+    // Digits in reverse, at least one before the point
+    do {
+        digits[n++] = (v % 10) + '0';
+        v /= 10;
+    } while(v || n <= decimals);
 
-// const struct ftoaInterface FTOA = {
-//     .convert = ftoa
-// };
\ No newline at end of file
+    // Right alignment
+    len = n + (decimals != 0) + negative;
+    while(len++ < width) res[i++] = ' ';
+
+    if(negative) res[i++] = '-';
+    while(n) {
+        res[i++] = digits[--n];
+        if(n && n == decimals) res[i++] = '.';
+    } res[i] = '\0';
+
+    return res;
+}
+
+// Converts a floating-point/double number to a string (|n| * 10^afterpoint has to fit in a long).
+void ftoa(float n, char* res, int afterpoint) { 
+    float scaled = n * pgm_read_dword(&POW10[afterpoint]);
+    fixtoa((long)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f), afterpoint, afterpoint, 0, res);
+} 
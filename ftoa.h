@@ -25,6 +25,12 @@
 //     void (*convert)(float, char*, int);
 // }; extern const struct ftoaInterface FTOA;
 
+#include <stdint.h>
+
+// `value` is the number multiplied by 10^`scale`; `decimals` digits after the point are printed,
+// rounded half away from zero, right aligned to `width` characters (0 - no padding)
+char *fixtoa(long value, uint8_t scale, uint8_t decimals, uint8_t width, char *res);
+
 void ftoa(float, char*, int);
 
-#endif  // FTOA_H
\ No newline at end of file
+#endif  // FTOA_H
@@ -0,0 +1,46 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#ifndef HOST_AVR_EEPROM_H
+#define HOST_AVR_EEPROM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// EEMEM variables are collected in their own section, which is the simulated EEPROM -
+// EEAR only keeps the low 16 bits of their address, `host/chip.c` puts the rest back
+#define EEMEM __attribute__((section("eeprom")))
+
+uint8_t  eeprom_read_byte(const uint8_t *p);
+uint16_t eeprom_read_word(const uint16_t *p);
+uint32_t eeprom_read_dword(const uint32_t *p);
+float    eeprom_read_float(const float *p);
+void     eeprom_read_block(void *dst, const void *src, size_t n);
+
+void eeprom_update_byte(uint8_t *p, uint8_t value);
+void eeprom_update_word(uint16_t *p, uint16_t value);
+void eeprom_update_dword(uint32_t *p, uint32_t value);
+void eeprom_update_float(float *p, float value);
+void eeprom_update_block(const void *src, void *dst, size_t n);
+
+#define eeprom_is_ready() 1
+#define eeprom_busy_wait()
+
+#endif  // HOST_AVR_EEPROM_H
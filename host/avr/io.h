@@ -0,0 +1,154 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+// ATmega328P registers used by the firmware, as plain memory simulated by `host/chip.c`
+extern volatile uint8_t PORTB, DDRB, PINB, PORTC, DDRC, PINC, PORTD, DDRD, PIND, SREG,
+                        EICRA, EIMSK, EIFR, PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2,
+                        TCCR0A, TCCR0B, TIMSK0, TIFR0, OCR0A, TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1, TCCR2A, TCCR2B,
+                        SPCR, ADMUX, UCSR0A, UCSR0B, UCSR0C, UDR0, SMCR;
+extern volatile uint16_t TCNT1, OCR1A, OCR1B, ICR1, ADC, EEAR, UBRR0;
+
+// Registers with side effects - every access goes through the simulator first,
+// so TCNT0 and TCNT2 follow simulated time, ADC conversions complete and EEPROM reads and writes happen.
+// SPDR is 16 bits wide here - bit 8 stays set until the firmware writes it, which tells a write from a read
+volatile uint8_t *hostTCNT0(void);
+volatile uint8_t *hostTCNT2(void);
+volatile uint8_t *hostADCSRA(void);
+volatile uint8_t *hostEECR(void);
+volatile uint8_t *hostEEDR(void);
+volatile uint8_t *hostSPSR(void);
+volatile uint16_t *hostSPDR(void);
+
+#define TCNT0  (*hostTCNT0())
+#define TCNT2  (*hostTCNT2())
+#define ADCSRA (*hostADCSRA())
+#define EECR   (*hostEECR())
+#define EEDR   (*hostEEDR())
+#define SPSR   (*hostSPSR())
+#define SPDR   (*hostSPDR())
+
+// Bits
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+
+#define ISC00 0
+#define ISC01 1
+#define ISC10 2
+#define ISC11 3
+#define INT0  0
+#define INT1  1
+#define INTF0 0
+#define INTF1 1
+
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+#define PCIF0 0
+#define PCIF1 1
+#define PCIF2 2
+#define PCINT0  0
+#define PCINT21 5
+#define PCINT23 7
+
+#define ADEN  7
+#define ADSC  6
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+#define REFS1 7
+#define REFS0 6
+#define MUX2  2
+#define MUX0  0
+
+#define CS00   0
+#define CS01   1
+#define CS02   2
+#define CS10   0
+#define CS11   1
+#define CS12   2
+#define CS20   0
+#define CS21   1
+#define CS22   2
+#define WGM01  1
+#define WGM10  0
+#define WGM11  1
+#define WGM12  3
+#define WGM13  4
+#define TOIE0  0
+#define TOIE1  0
+#define OCIE1A 1
+#define OCIE1B 2
+#define TOV0   0
+#define TOV1   0
+#define OCF1A  1
+#define OCF1B  2
+
+#define SPIE  7
+#define SPE   6
+#define MSTR  4
+#define SPR1  1
+#define SPR0  0
+#define SPIF  7
+#define WCOL  6
+#define SPI2X 0
+
+#define EERIE 3
+#define EEMPE 2
+#define EEPE  1
+#define EERE  0
+
+#define U2X0   1
+#define UDRE0  5
+#define UDRIE0 5
+#define RXEN0  4
+#define TXEN0  3
+#define UCSZ01 2
+#define UCSZ00 1
+
+#define SE  0
+#define SM0 1
+
+#define _BV(bit) (1<<(bit))
+
+#endif  // HOST_AVR_IO_H
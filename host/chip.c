@@ -0,0 +1,215 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+
+#include "host.h"
+
+volatile uint8_t PORTB, DDRB, PINB = 0xFF, PORTC, DDRC, PINC = 0xFF, PORTD, DDRD, PIND = 0xFF, SREG,
+                 EICRA, EIMSK, EIFR, PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2,
+                 TCCR0A, TCCR0B, TIMSK0, TIFR0, OCR0A, TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1, TCCR2A, TCCR2B,
+                 SPCR, ADMUX, UCSR0A, UCSR0B, UCSR0C, UDR0, SMCR;
+volatile uint16_t TCNT1, OCR1A, OCR1B, ICR1, ADC, EEAR, UBRR0;
+
+static volatile uint8_t tcnt0, tcnt2, adcsra, eecr, eedr, spsr;
+static volatile uint16_t spdr = 0x1FF;
+static uint8_t spiShift, spiBusy, spifRead, spiVector;
+
+uint64_t hostNow = 0;
+uint64_t hostT0Next = 0;
+uint16_t hostAdc = 0;
+uint64_t hostEeReady = 0;
+unsigned long hostEeWrites = 0;
+uint32_t hostEeWear[HOST_EEPROM_CELLS];
+uint32_t hostReadCycles = 0;
+void (*hostSpiByte)(uint8_t byte) = NULL;
+unsigned long hostSpiCollisions = 0;
+
+// SPI_STC vector of the firmware, if it has one
+void SPI_STC_vect(void) __attribute__((weak));
+
+// Simulated EEPROM, filled by the linker with every EEMEM variable - tests without any have none
+extern uint8_t __start_eeprom[] __attribute__((weak)), __stop_eeprom[] __attribute__((weak));
+
+
+uint32_t hostPrescaler(uint8_t tccr) {
+    static const uint16_t div[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+    return div[tccr & 7];
+}
+
+uint8_t *hostEeprom(void) {return __start_eeprom;}
+uint16_t hostEepromSize(void) {return __stop_eeprom - __start_eeprom;}
+
+static uint8_t *eepromCell(uint16_t addr) {
+    uintptr_t base = (uintptr_t)__start_eeprom;
+    uintptr_t cell = (base & ~(uintptr_t)0xFFFF) | addr;
+
+    if(cell < base) cell += 0x10000;
+    if(cell >= (uintptr_t)__stop_eeprom) {
+        fprintf(stderr, "EEPROM access outside of EEMEM at 0x%04x\n", addr);
+        exit(1);
+    }
+    return (uint8_t*)cell;
+}
+
+// Carries out what the firmware has asked EECR for since the last access
+void hostEepromSync(void) {
+    if(eecr & (1<<EERE)) {
+        eedr = *eepromCell(EEAR);
+        eecr &= ~(1<<EERE);
+    }
+    if((eecr & (1<<EEPE)) && (eecr & (1<<EEMPE))) {
+        uint8_t *cell = eepromCell(EEAR);
+
+        *cell = eedr;
+        if(cell - __start_eeprom < HOST_EEPROM_CELLS) ++hostEeWear[cell - __start_eeprom];
+        eecr &= ~((1<<EEPE) | (1<<EEMPE));
+        hostEeReady = hostNow + HOST_EEPROM_CYCLES;
+        ++hostEeWrites;
+    }
+}
+
+volatile uint8_t *hostTCNT0(void) {
+    uint32_t p = hostPrescaler(TCCR0B);
+
+    if(p) {
+        tcnt0 = hostNow / p;
+        if(hostT0Next && hostNow >= hostT0Next) TIFR0 |= (1<<TOV0);  // Overflow waits behind a higher priority vector
+    }
+    return &tcnt0;
+}
+
+volatile uint8_t *hostTCNT2(void) {
+    static const uint16_t div[8] = {0, 1, 8, 32, 64, 128, 256, 1024};  // TIMER2 has its own prescaler steps
+    uint32_t p = div[TCCR2B & 7];
+
+    hostNow += hostReadCycles;
+    if(p) tcnt2 = hostNow / p;
+    return &tcnt2;
+}
+
+// Takes the byte the firmware has written to SPDR since the last access. Written during a transfer, it's lost
+static void spiSync(void) {
+    if(spdr & 0x100) return;
+
+    if(spiBusy) {
+        spsr |= (1<<WCOL);
+        ++hostSpiCollisions;
+    } else {
+        spiShift = spdr;
+        spiBusy = 1;
+    }
+    spdr = 0x1FF;
+}
+
+// SPI_STC is taken as soon as SPIF and SPIE are both set - the host has no `cli()`, so that's at once
+static void spiInterrupt(void) {
+    if(spiVector || !SPI_STC_vect || !(SPCR & (1<<SPIE)) || !(spsr & (1<<SPIF))) return;
+
+    spsr &= ~(1<<SPIF);  // Cleared by hardware on entry
+    spifRead = 0;
+    spiVector = 1;
+    SPI_STC_vect();
+    spiVector = 0;
+    spiSync();
+}
+
+uint8_t hostSpiComplete(void) {
+    spiSync();
+    if(!spiBusy) return 0;
+
+    spiBusy = 0;
+    spsr |= (1<<SPIF);
+    if(hostSpiByte) hostSpiByte(spiShift);
+    spiInterrupt();
+    return 1;
+}
+
+// A polled transfer is done by the time SPSR is read
+volatile uint8_t *hostSPSR(void) {
+    spiSync();
+    if(!(SPCR & (1<<SPIE)) && spiBusy) hostSpiComplete();
+    if(spsr & (1<<SPIF)) spifRead = 1;
+    return &spsr;
+}
+
+// Reading SPSR with SPIF set and then accessing SPDR clears SPIF and WCOL
+volatile uint16_t *hostSPDR(void) {
+    spiSync();
+    spiInterrupt();
+    if(spifRead) {
+        spsr &= ~((1<<SPIF) | (1<<WCOL));
+        spifRead = 0;
+    }
+    return &spdr;
+}
+
+volatile uint8_t *hostADCSRA(void) {
+    if(adcsra & (1<<ADSC)) {
+        ADC = hostAdc;
+        adcsra &= ~(1<<ADSC);
+    }
+    return &adcsra;
+}
+
+volatile uint8_t *hostEECR(void) {hostEepromSync(); return &eecr;}
+volatile uint8_t *hostEEDR(void) {hostEepromSync(); return &eedr;}
+
+
+uint8_t  eeprom_read_byte(const uint8_t *p) {return *p;}
+uint16_t eeprom_read_word(const uint16_t *p) {uint16_t v; memcpy(&v, p, sizeof(v)); return v;}
+uint32_t eeprom_read_dword(const uint32_t *p) {uint32_t v; memcpy(&v, p, sizeof(v)); return v;}
+float    eeprom_read_float(const float *p) {float v; memcpy(&v, p, sizeof(v)); return v;}
+void     eeprom_read_block(void *dst, const void *src, size_t n) {memcpy(dst, src, n);}
+
+void eeprom_update_byte(uint8_t *p, uint8_t value) {*p = value;}
+void eeprom_update_word(uint16_t *p, uint16_t value) {memcpy(p, &value, sizeof(value));}
+void eeprom_update_dword(uint32_t *p, uint32_t value) {memcpy(p, &value, sizeof(value));}
+void eeprom_update_float(float *p, float value) {memcpy(p, &value, sizeof(value));}
+void eeprom_update_block(const void *src, void *dst, size_t n) {memcpy(dst, src, n);}
+
+
+static char *convert(unsigned long value, char negative, char *str, int radix) {
+    char *p = str, *q;
+
+    if(negative) *p++ = '-';
+    q = p;
+    do {
+        *p++ = "0123456789abcdefghijklmnopqrstuvwxyz"[value % radix];
+        value /= radix;
+    } while(value);
+    *p-- = '\0';
+
+    while(q < p) {char c = *q; *q++ = *p; *p-- = c;}
+    return str;
+}
+
+char *itoa(int value, char *str, int radix) {return ltoa(value, str, radix);}
+char *ltoa(long value, char *str, int radix) {
+    char negative = value < 0 && radix == 10;
+    return convert(negative ? -(unsigned long)value : (unsigned long)value, negative, str, radix);
+}
+char *utoa(unsigned int value, char *str, int radix) {return convert(value, 0, str, radix);}
+char *ultoa(unsigned long value, char *str, int radix) {return convert(value, 0, str, radix);}
@@ -0,0 +1,377 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+
+#include "host.h"
+#include "../trip.h"
+#include "../mock.h"
+#include "../persist.h"
+#include "../speed.h"
+
+#define NEVER UINT64_MAX
+
+// Firmware entry and vectors - `main()` of the firmware is renamed by the host build
+int ubcMain(void);
+void INT0_vect(void);
+void INT1_vect(void);
+void PCINT0_vect(void);
+void PCINT2_vect(void);
+void TIMER1_COMPA_vect(void);
+void TIMER0_OVF_vect(void);
+void EE_READY_vect(void);
+void USART_UDRE_vect(void) __attribute__((weak));   // Compiled out with USE_TELEMETRY 0
+
+// Settings as the firmware keeps them - must match `eeStruct`, SAVE_FLAG and EEPROM_FORMAT in main.c
+extern struct {
+    float divideFuelFactor;
+    float pulseDistance;
+    float injectionValue;
+    uint16_t saveFlag;
+    uint16_t format;
+} eeSavedData;
+#define SAVE_FLAG 0x71F5
+#define EEPROM_FORMAT 2
+
+extern volatile unsigned int rangeDistance;
+
+static hostDrive drive = {90, 2500, 3.0};
+static float pulseDistance = 0.00006823f, injectionValue = 0.0025f, divideFuelFactor = 20;
+static double hours = 0;
+static const char *eepromFile = NULL;
+static uint8_t eepromText = 0;        // Image is a SimulIDE dump, saved back the same way
+static FILE *telemetry = NULL, *ticksOut = NULL;
+
+// Recorded drive, used instead of the constant one - see `traceRead()`
+static FILE *trace = NULL;
+static hostEvent event;
+static unsigned long traceLine = 0;
+
+static uint64_t endAt, t1Next, vssNext, injNext, uartReady;
+static double vssAt, injAt;           // Exact edge times - cycles between edges aren't whole numbers
+static uint8_t injOpen = 0;
+static unsigned long events = 0;
+static struct timespec started;
+
+
+// One event per line, time in microseconds from reset and a pin or value:
+//   <us> V      VSS pulse (falling edge on INT0)
+//   <us> I 1|0  injector opens or closes (PD3 low while open)
+//   <us> N 1|0  NEXT button pressed or released, B - BACK, F - FUNC
+//   <us> A n    fuel level ADC reading from now on
+// Lines starting with # are skipped. Returns 0 at the end of the trace
+static uint8_t traceRead(void) {
+    char line[128], *p;
+    double us;
+    uint64_t at;
+
+    while(fgets(line, sizeof(line), trace)) {
+        ++traceLine;
+        if(line[0] == '#' || line[0] == '\n') continue;
+
+        // Parsed by hand - sscanf() alone would take most of the replay time
+        us = strtod(line, &p);
+        event.kind = 0;
+        if(p != line) {
+            while(*p == ' ') ++p;
+            event.kind = *p++;
+            event.value = (*p == ' ') ? strtol(p, NULL, 10) : 1;
+        }
+        if(!event.kind || !strchr("VINBFA", event.kind)) {
+            line[strcspn(line, "\n")] = '\0';
+            fprintf(stderr, "trace line %lu: can't read \"%s\"\n", traceLine, line);
+            exit(1);
+        }
+
+        at = us * (F_CPU / 1000000.0);
+        if(at < event.at) {
+            fprintf(stderr, "trace line %lu: goes back in time\n", traceLine);
+            exit(1);
+        }
+        event.at = at;
+        return 1;
+    }
+    return 0;
+}
+
+static void pinSet(volatile uint8_t *pin, uint8_t bit, uint8_t low) {
+    if(low) *pin &= ~(1<<bit);
+    else *pin |= (1<<bit);
+}
+
+// Applies the event at `hostNow` - returns 1 if it ran an interrupt and so wakes the firmware
+static uint8_t traceEvent(void) {
+    uint8_t ran = 0;
+
+    switch(event.kind) {
+        case 'V':
+            PIND &= ~(1<<PD2);
+            if(EIMSK & (1<<INT0)) {INT0_vect(); ran = 1;}
+            PIND |= (1<<PD2);
+        break;
+
+        case 'I':
+            pinSet(&PIND, PD3, event.value);
+            if(EIMSK & (1<<INT1)) {INT1_vect(); ran = 1;}
+        break;
+
+        case 'N':
+            pinSet(&PIND, PD7, event.value);
+            if((PCICR & (1<<PCIE2)) && (PCMSK2 & (1<<PCINT23))) {PCINT2_vect(); ran = 1;}
+        break;
+
+        case 'B':
+            pinSet(&PINB, PB0, event.value);
+            if((PCICR & (1<<PCIE0)) && (PCMSK0 & (1<<PCINT0))) {PCINT0_vect(); ran = 1;}
+        break;
+
+        case 'F': pinSet(&PIND, PD6, event.value); break;
+        case 'A': hostAdc = event.value; break;
+    }
+
+    if(!traceRead()) {
+        // A second more, so the last values get shown
+        fclose(trace);
+        trace = NULL;
+        if(!hours) endAt = hostNow + F_CPU;
+    }
+    return ran;
+}
+
+// EEPROM image of an earlier run, or a SimulIDE dump like the ones in `sketch/` - decimal bytes
+// separated by commas. Returns 0 if there's none
+static uint8_t eepromLoad(const char *name) {
+    static char text[8192];
+    uint8_t *cell = hostEeprom();
+    uint16_t size = hostEepromSize(), n = 0;
+    size_t len;
+    char *p, *end;
+    FILE *f = fopen(name, "rb");
+
+    if(!f) return 0;
+    len = fread(text, 1, sizeof(text) - 1, f);
+    fclose(f);
+    text[len] = '\0';
+
+    eepromText = len && strchr(text, ',') && strspn(text, "0123456789, \t\r\n") == len;
+    if(!eepromText) {
+        memcpy(cell, text, len < size ? len : size);
+        return 1;
+    }
+
+    // Smaller dumps (ATmega8 has 512 bytes) leave the rest erased
+    for(p = text; n != size; ++n, p = end + strspn(end, ", \t\r\n")) {
+        cell[n] = strtol(p, &end, 10);
+        if(end == p) break;
+    }
+    return 1;
+}
+
+static void eepromSave(const char *name) {
+    uint8_t *cell = hostEeprom();
+    uint16_t size = hostEepromSize(), n;
+    FILE *f = fopen(name, "wb");
+
+    if(!f) return;
+    if(!eepromText) fwrite(cell, 1, size, f);
+    else for(n = 0; n != size; ++n) fprintf(f, "%4u%s", cell[n], (n + 1 == size || n % 16 == 15) ? "\n" : ",");
+    fclose(f);
+}
+
+static void finish(void) {
+    struct timespec now;
+    double wall, simulated = hostNow / (double)F_CPU / 3600;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    wall = (now.tv_sec - started.tv_sec) + (now.tv_nsec - started.tv_nsec) / 1e9;
+
+    printf("simulated   %.2f h in %.3f s - %.1f simulated hours per second (%.0fx real time), %lu interrupts\n",
+           simulated, wall, wall > 0 ? simulated / wall : 0, wall > 0 ? simulated * 3600 / wall : 0, events);
+    printf("counters    %llu VSS pulses, %llu injector ticks\n", (unsigned long long)trip.pulses, (unsigned long long)trip.fuelTicks);
+    printf("distance    %.3f km, sailing %.3f km\n", tripDistance() / 1000.0, tripSailingDistance() / 1000.0);
+    printf("fuel        %.3f L\n", tripFuel() / 1000.0);
+    printf("speed       %u km/h, average %u km/h, shown %.1f km/h %s\n", tripNow.speed, tripNow.avgSpeed,
+           speedNow.speed / 10.0, speedNow.stopped ? "(stopped)" : (speedNow.counting ? "(counted)" : "(edge periods)"));
+    printf("consumption %.2f now, %.2f L/100km average\n", tripNow.instantFuel / 100.0, tripNow.avgFuel / 100.0);
+    printf("windows     %.2f 1 km, %.2f 10 km, %.2f 100 km, %.2f 5 min\n", tripWindow(TRIP_WINDOW_1KM) / 100.0,
+           tripWindow(TRIP_WINDOW_10KM) / 100.0, tripWindow(TRIP_WINDOW_100KM) / 100.0, tripWindow(TRIP_WINDOW_5MIN) / 100.0);
+    printf("frames      %u, EEPROM bytes programmed %lu\n", mockFrames, hostEeWrites);
+
+    if(eepromFile) eepromSave(eepromFile);
+    if(telemetry) fclose(telemetry);
+    if(ticksOut) fclose(ticksOut);
+    exit(0);
+}
+
+// Runs the next interrupt - same cycle events go lowest vector first, as on the chip
+void hostSleep(void) {
+    uint32_t p0 = hostPrescaler(TCCR0B), p1 = hostPrescaler(TCCR1B);
+    uint64_t t0, t1, udre, ee, vss, inj, tr, next;
+
+    do {
+        hostEepromSync();
+
+        if(p0 && !hostT0Next) hostT0Next = 256ULL * p0;
+        if(p1 && !t1Next) t1Next = (OCR1A + 1ULL) * p1;
+
+        // Trace events are pins, all of them on lower vectors than the peripherals
+        tr   = trace ? event.at : NEVER;
+        vss  = (EIMSK & (1<<INT0)) ? vssNext : NEVER;
+        inj  = (EIMSK & (1<<INT1)) ? injNext : NEVER;
+        t0   = (p0 && (TIMSK0 & (1<<TOIE0))) ? hostT0Next : NEVER;
+        t1   = (p1 && (TIMSK1 & (1<<OCIE1A))) ? t1Next : NEVER;
+        udre = (UCSR0B & (1<<UDRIE0)) ? (uartReady > hostNow ? uartReady : hostNow) : NEVER;
+        ee   = (EECR & (1<<EERIE)) ? (hostEeReady > hostNow ? hostEeReady : hostNow) : NEVER;
+
+        next = tr;
+        if(vss < next) next = vss;
+        if(inj < next) next = inj;
+        if(t1 < next) next = t1;
+        if(t0 < next) next = t0;
+        if(udre < next) next = udre;
+        if(ee < next) next = ee;
+
+        if(next >= endAt) {
+            hostNow = endAt;
+            finish();
+        }
+        hostNow = next;
+    } while(next == tr && !traceEvent());   // Silent events don't wake the firmware
+
+    ++events;
+    if(next == tr) return;
+
+    if(next == vss) {
+        // Falling edge of a short VSS pulse
+        PIND &= ~(1<<PD2);
+        INT0_vect();
+        PIND |= (1<<PD2);
+        vssAt += F_CPU * 3600.0 * pulseDistance / drive.speed;
+        vssNext = vssAt;
+
+    } else if(next == inj) {
+        // Injector pulls PD3 low while it's open
+        if(!injOpen) PIND &= ~(1<<PD3);
+        else PIND |= (1<<PD3);
+        injOpen = !injOpen;
+        INT1_vect();
+
+        if(injOpen) injNext = injAt + drive.width * F_CPU / 1000;
+        else {
+            injAt += F_CPU * 120.0 / drive.rpm;
+            injNext = injAt;
+        }
+
+    } else if(next == t1) {
+        // What the firmware shows after the ticks so far
+        if(ticksOut) fprintf(ticksOut, "%.2f,%u,%u,%u,%u,%u\n", (double)hostNow / F_CPU, tripNow.speed, 
+                             tripNow.instantFuel, tripNow.avgFuel, rangeDistance, tripFuel());
+
+        // The ISR may set the length of the tick that has just started
+        TIMER1_COMPA_vect();
+        t1Next += (OCR1A + 1ULL) * p1;
+
+    } else if(next == t0) {
+        hostT0Next += 256ULL * p0;
+        TIFR0 &= ~(1<<TOV0);
+        TIMER0_OVF_vect();
+
+    } else if(next == udre) {
+        USART_UDRE_vect();
+        if(UCSR0B & (1<<UDRIE0)) {
+            // 10 bits per byte, double speed
+            uartReady = hostNow + 10ULL * 8 * (UBRR0 + 1);
+            if(telemetry) fputc(UDR0, telemetry);
+        }
+
+    } else EE_READY_vect();
+}
+
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-s km/h] [-r rpm] [-w injection ms] [-a fuel ADC] [-t hours] [-f trace]\n"
+                    "          [-p km per pulse] [-i L/s per injector] [-d ADC per L] [-e EEPROM image]\n"
+                    "          [-u telemetry file] [-o per tick CSV]\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+
+    while((opt = getopt(argc, argv, "s:r:w:a:t:p:i:d:e:u:f:o:")) != -1) {
+        switch(opt) {
+            case 's': drive.speed = atof(optarg); break;
+            case 'r': drive.rpm = atof(optarg); break;
+            case 'w': drive.width = atof(optarg); break;
+            case 'a': hostAdc = atoi(optarg); break;
+            case 't': hours = atof(optarg); break;
+            case 'p': pulseDistance = atof(optarg); break;
+            case 'i': injectionValue = atof(optarg); break;
+            case 'd': divideFuelFactor = atof(optarg); break;
+            case 'e': eepromFile = optarg; break;
+            case 'u': 
+                if(!(telemetry = fopen(optarg, "wb"))) {perror(optarg); return 1;}
+            break;
+            case 'f': 
+                if(!(trace = fopen(optarg, "r"))) {perror(optarg); return 1;}
+            break;
+            case 'o': 
+                if(!(ticksOut = fopen(optarg, "w"))) {perror(optarg); return 1;}
+                fprintf(ticksOut, "time,speed,instant,average,range,fuel\n");
+            break;
+            default: usage(argv[0]);
+        }
+    }
+    if(drive.rpm > 0 && drive.width * F_CPU / 1000 >= F_CPU * 120.0 / drive.rpm) {
+        fprintf(stderr, "Injector can't be open longer than two revolutions\n");
+        return 2;
+    }
+
+    // Erased EEPROM, or the image of an earlier run - calibration is written like `saveCalibration()` does
+    memset(hostEeprom(), 0xFF, hostEepromSize());
+    if(!eepromFile || !eepromLoad(eepromFile)) {
+        eeSavedData.divideFuelFactor = divideFuelFactor;
+        eeSavedData.pulseDistance = pulseDistance;
+        eeSavedData.injectionValue = injectionValue;
+        eeSavedData.saveFlag = SAVE_FLAG;
+        eeSavedData.format = EEPROM_FORMAT;
+    }
+
+    // A trace runs to its end, the constant drive for an hour
+    endAt = hours ? hours * 3600 * F_CPU : (trace ? NEVER : 3600ULL * F_CPU);
+    if(trace && !traceRead()) {
+        fprintf(stderr, "Empty trace\n");
+        return 1;
+    }
+    vssAt = F_CPU * 3600.0 * pulseDistance / drive.speed;
+    vssNext = (drive.speed > 0 && !trace) ? vssAt : NEVER;
+    injAt = F_CPU * 120.0 / drive.rpm;
+    injNext = (drive.rpm > 0 && !trace) ? injAt : NEVER;
+
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    return ubcMain();
+}
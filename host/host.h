@@ -0,0 +1,62 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+
+// Simulated ATmega328P around the unchanged firmware - registers are memory, peripherals are events
+// in simulated CPU cycles, and time only passes while the firmware sleeps. Built with `make host`
+#define HOST_EEPROM_CYCLES (F_CPU / 1000 * 34 / 10)   // One EEPROM byte takes 3.4 ms to program
+#define HOST_EEPROM_CELLS  2048       // Wear is counted for this many - host structs are wider than the 1 KB of the chip
+
+// Constant drive fed to the VSS and injector inputs
+typedef struct {
+    double speed;                     // km/h
+    double rpm;                       // Engine speed - one injection every two revolutions
+    double width;                     // Injector open time, ms
+} hostDrive;
+
+// Recorded input change
+typedef struct {
+    uint64_t at;                      // Cycles
+    char kind;
+    int value;
+} hostEvent;
+
+// Simulated chip in `host/chip.c`, shared by the host build and the tests in `test/`
+extern uint64_t hostNow;              // Simulated CPU cycles since reset
+extern uint64_t hostT0Next;           // Cycle of the next TIMER0 overflow, 0 - not counting yet
+extern uint16_t hostAdc;              // What ADC conversions read - fuel level, 0 - read from the tank counter
+extern uint64_t hostEeReady;          // Cycle EEPROM finishes programming the last byte
+extern unsigned long hostEeWrites;    // Bytes programmed
+extern uint32_t hostEeWear[HOST_EEPROM_CELLS];  // ... of every cell, from the start of EEMEM
+extern uint32_t hostReadCycles;       // Cycles every TCNT2 read moves time on, so tests see the time code measures
+extern void (*hostSpiByte)(uint8_t byte);   // Gets every byte the SPI unit shifts out
+extern unsigned long hostSpiCollisions;     // SPDR written while a byte was still being shifted out
+
+uint32_t hostPrescaler(uint8_t tccr);
+uint8_t hostSpiComplete(void);        // Shifts out the byte in flight and takes SPI_STC if it's enabled - 0 if none
+void hostEepromSync(void);
+uint8_t *hostEeprom(void);
+uint16_t hostEepromSize(void);
+
+#endif  // HOST_H
@@ -0,0 +1,32 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#ifndef HOST_STDLIB_H
+#define HOST_STDLIB_H
+
+#include_next <stdlib.h>
+
+// avr-libc conversions, implemented in `host/chip.c`
+char *itoa(int value, char *str, int radix);
+char *ltoa(long value, char *str, int radix);
+char *utoa(unsigned int value, char *str, int radix);
+char *ultoa(unsigned long value, char *str, int radix);
+
+#endif  // HOST_STDLIB_H
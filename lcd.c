@@ -20,27 +20,66 @@
 // <https://github.com/LittleBuster>
 
 
-#include "lcd.h"
+#include "display.h"
+
+#if USE_PCD8544 == 1
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include <avr/pgmspace.h>
 #include <util/delay.h>
-
-#include "chars.h"
+#include <string.h>
 
 
 static struct {
     uint8_t screen[504];
 
-    uint8_t cursorX;
-    uint8_t cursorY;
+    uint8_t dirtyLo[LCD_BANKS];  // First changed column in every bank since last render
+    uint8_t dirtyHi[LCD_BANKS];  // Last changed column in every bank since last render
+    uint16_t sent;               // Bytes shifted out during last frame
+    uint32_t cycles;             // CPU cycles spent on last frame transfer
 
 } screenLCD = {
-    .cursorX = 0,
-    .cursorY = 0
+    .dirtyLo = {LCD_CLEAN, LCD_CLEAN, LCD_CLEAN, LCD_CLEAN, LCD_CLEAN, LCD_CLEAN},
+    .dirtyHi = {0},
+    .sent = 0,
+    .cycles = 0
+};
+
+#if LCD_USE_SPI == 1
+// Front buffer streamed by SPI_STC interrupt while main loop draws into `screenLCD.screen`
+static volatile struct {
+    uint8_t screen[504];
+
+    uint8_t lo[LCD_BANKS];  // Spans latched by the last swap
+    uint8_t hi[LCD_BANKS];
+
+    uint8_t bank;           // Bank being sent
+    uint8_t x;              // Next column to send
+    uint8_t step;           // 0 - column command, 1 - bank command, 2 - data
+    uint8_t busy;
+
+    uint16_t sent;
+    uint32_t cycles;
+} frontLCD = {
+    .busy = 0
 };
+#endif
 
 
+#if LCD_USE_SPI == 1
+static void write(uint8_t bytes, uint8_t isData) {
+	PORT_LCD &= ~(1<<LCD_SCE);  		 // Enable controller
+
+	if(isData) PORT_LCD |= (1<<LCD_DC);  // Sending data
+	else PORT_LCD &= ~(1<<LCD_DC);  	 // Sending commands
+
+	// Polled transfer, only used before the interrupt driven one takes over
+	SPDR = bytes;
+	while(!(SPSR & (1<<SPIF)));
+	PORT_LCD |= (1 << LCD_SCE);
+}
+#else
 static void write(uint8_t bytes, uint8_t isData) {
 	register uint8_t i;
 	PORT_LCD &= ~(1<<LCD_SCE);  		 // Enable controller
@@ -56,27 +95,51 @@ static void write(uint8_t bytes, uint8_t isData) {
 		PORT_LCD &= ~(1<<LCD_CLK);
 	} PORT_LCD |= (1 << LCD_SCE);
 }
+#endif
 static void writeCmd(uint8_t cmd) {write(cmd, 0);}
 static void writeData(uint8_t data) {write(data, 1);}
 
+static inline void markDirty(uint8_t bank, uint8_t x) {
+	if(x < screenLCD.dirtyLo[bank]) screenLCD.dirtyLo[bank] = x;
+	if(x > screenLCD.dirtyHi[bank]) screenLCD.dirtyHi[bank] = x;
+}
+
+static inline void putByte(uint8_t bank, uint8_t x, uint8_t value) {
+	uint8_t *byte = &screenLCD.screen[bank*LCD_WIDTH+x];
+
+	// Only bytes that really differ from the glass have to be shifted out
+	if(*byte == value) return;
+	*byte = value;
+	markDirty(bank, x);
+}
+
 
 void screenLCDInit(void) {
 	register unsigned i;
 	
     // Set pins as output
 	DDR_LCD |= (1<<LCD_SCE);
-	DDR_LCD |= (1<<LCD_RST);
+	DDR_RST |= (1<<LCD_RST);
 	DDR_LCD |= (1<<LCD_DC);
 	DDR_LCD |= (1<<LCD_DIN);
 	DDR_LCD |= (1<<LCD_CLK);
 
 	// Reset display
-	PORT_LCD |= (1<<LCD_RST);
+	PORT_RST |= (1<<LCD_RST);
 	PORT_LCD |= (1<<LCD_SCE);
 	_delay_ms(10);
-	PORT_LCD &= ~(1<<LCD_RST);
+	PORT_RST &= ~(1<<LCD_RST);
 	_delay_ms(70);
-	PORT_LCD |= (1<<LCD_RST);
+	PORT_RST |= (1<<LCD_RST);
+
+	// Cycle clock, normal mode
+	TCCR2A = 0;
+	TCCR2B = LCD_CLOCK_CS;
+
+	#if LCD_USE_SPI == 1
+	// Master, MSB first, mode 0, fosc/16 - leaves the CPU most of every byte time between interrupts
+	SPCR = (1<<SPE) | (1<<MSTR) | (1<<SPR0);
+	#endif
 
 
 	// Initialize display and enable controller
@@ -99,73 +162,210 @@ void screenLCDInit(void) {
 }
 
 void screenLCDClear(void) {
-	register unsigned i;
-    
-	// Set column and row to 0
-	writeCmd(0x80);
-	writeCmd(0x40);
+	register uint8_t bank, x;
 
-	// Cursor too
-	screenLCD.cursorX = 0;
-	screenLCD.cursorY = 0;
-	
     // Clear everything (504 bytes = 84cols * 48rows / 8bits)
-	for(i = 0; i != 504; ++i) screenLCD.screen[i] = 0x00;
+	for(bank = 0; bank != LCD_BANKS; ++bank)
+		for(x = 0; x != LCD_WIDTH; ++x) putByte(bank, x, 0x00);
 }
 
 void screenLCDPower(uint8_t on) {writeCmd(on ? 0x20 : 0x24);}
 
 void screenLCDSetPixel(uint8_t x, uint8_t y, uint8_t value) {
-	uint8_t *byte = &screenLCD.screen[y/8*84+x];
-	if(value) *byte |= (1<<(y%8));
-	else *byte &= ~(1<<(y%8));
+	uint8_t byte = screenLCD.screen[y/8*LCD_WIDTH+x];
+	if(value) byte |= (1<<(y%8));
+	else byte &= ~(1<<(y%8));
+	putByte(y/8, x, byte);
 }
 
-void screenLCDWriteChar(char code, uint8_t scale) {
-	register uint8_t x, y;
+// Writes `height` bits of one column starting at any `y`, leaving the other pixels of touched bytes intact
+void screenLCDColumn(uint8_t x, uint8_t y, uint32_t bits, uint8_t height) {
+	register uint8_t bank = y >> 3;
+	uint32_t mask;
 
-	for(x = 0; x != 5*scale; ++x)
-		for (y = 0; y != 7*scale; ++y)
-			if(pgm_read_byte(&CHARSET[code-32][x/scale]) & (1 << y/scale))
-				screenLCDSetPixel(screenLCD.cursorX + x, screenLCD.cursorY + y, 1);
-			else screenLCDSetPixel(screenLCD.cursorX + x, screenLCD.cursorY + y, 0);
+	if(x >= LCD_WIDTH) return;
 
-	screenLCD.cursorX += 5*scale + 1;
-	if(screenLCD.cursorX >= 84) {
-		screenLCD.cursorX = 0;
-		screenLCD.cursorY += 7*scale + 1;
-	} 
-    
-    if(screenLCD.cursorY >= 48) {
-		screenLCD.cursorX = 0;
-		screenLCD.cursorY = 0;
+	// Byte aligned scale 1 text - one byte per column
+	if(height == 7 && !(y & 7)) {
+		if(bank != LCD_BANKS) putByte(bank, x, (screenLCD.screen[bank*LCD_WIDTH+x] & 0x80) | (uint8_t)bits);
+		return;
 	}
-} void screenLCDWriteString(const char *str, uint8_t scale) {while(*str) screenLCDWriteChar(*str++, scale);}
 
-void screenLCDSetCursor(uint8_t x, uint8_t y) {
-	screenLCD.cursorX = x;
-	screenLCD.cursorY = y;
+	mask = ((1UL<<height) - 1) << (y & 7);
+	bits <<= (y & 7);
+	for(; mask && bank != LCD_BANKS; ++bank, mask >>= 8, bits >>= 8)
+		putByte(bank, x, (screenLCD.screen[bank*LCD_WIDTH+x] & ~(uint8_t)mask) | ((uint8_t)bits & (uint8_t)mask));
 }
 
-void screenLCDRender(void) {
-	register unsigned i;
+void screenLCDBackground(const uint8_t *bitmap) {
+	register uint8_t bank;
 
-	// Set column and row to 0
-	writeCmd(0x80);
-	writeCmd(0x40);
+	// New layer means the whole glass changes anyway
+	for(bank = 0; bank != LCD_BANKS; ++bank) {
+		memcpy_P(&screenLCD.screen[bank*LCD_WIDTH], &bitmap[bank*LCD_WIDTH], LCD_WIDTH);
+		screenLCD.dirtyLo[bank] = 0;
+		screenLCD.dirtyHi[bank] = LCD_WIDTH-1;
+	}
+}
+
+void screenLCDRestore(const uint8_t *bitmap, uint8_t x, uint8_t y, uint8_t width, uint8_t height) {
+	register uint8_t bank, i;
+	uint8_t last = (y+height-1) >> 3;
+	uint8_t end = (x+width > LCD_WIDTH) ? LCD_WIDTH : x+width;
+
+	if(last >= LCD_BANKS) last = LCD_BANKS-1;
+	for(bank = y >> 3; bank <= last; ++bank)
+		for(i = x; i != end; ++i) putByte(bank, i, pgm_read_byte(&bitmap[bank*LCD_WIDTH+i]));
+}
 
-	// Write screen to display
-	for(i = 0; i != 504; ++i) writeData(screenLCD.screen[i]);
+#if LCD_USE_SPI == 1
+// Feeds the next command or data byte of the latched spans to SPI
+static void spiNext(void) {
+	while(frontLCD.bank != LCD_BANKS) {
+		register uint8_t bank = frontLCD.bank;
+
+		if(frontLCD.lo[bank] > frontLCD.hi[bank]) {
+			++frontLCD.bank;
+			continue;
+		}
+
+		switch(frontLCD.step) {
+			case 0:
+				PORT_LCD &= ~(1<<LCD_DC);
+				frontLCD.step = 1;
+				SPDR = 0x80 | frontLCD.lo[bank];
+			return;
+
+			case 1:
+				frontLCD.step = 2;
+				frontLCD.x = frontLCD.lo[bank];
+				SPDR = 0x40 | bank;
+			return;
+
+			default:
+				if(frontLCD.x <= frontLCD.hi[bank]) {
+					PORT_LCD |= (1<<LCD_DC);
+					SPDR = frontLCD.screen[bank*LCD_WIDTH + frontLCD.x++];
+					return;
+				}
+
+				frontLCD.step = 0;
+				++frontLCD.bank;
+			break;
+		}
+	}
+
+	// Everything has been sent
+	SPCR &= ~(1<<SPIE);
+	PORT_LCD |= (1<<LCD_SCE);
+	frontLCD.busy = 0;
 }
 
+ISR(SPI_STC_vect) {
+	uint8_t start = LCD_CLOCK;
+	spiNext();
+	frontLCD.cycles += (uint8_t)(LCD_CLOCK - start) * LCD_CLOCK_DIV;
+}
+
+uint8_t screenLCDSwap(void) {
+	register uint8_t bank;
+	register unsigned i, end, n;
+	uint8_t start, oldSREG;
+	uint16_t sent = 0;
+	uint32_t cycles = 0;
+
+	if(frontLCD.busy) return 0;
+	screenLCD.sent = frontLCD.sent;
+	screenLCD.cycles = frontLCD.cycles;
+
+	// Only changed spans are copied into the front buffer, timed a chunk at a time
+	for(bank = 0; bank != LCD_BANKS; ++bank) {
+		frontLCD.lo[bank] = screenLCD.dirtyLo[bank];
+		frontLCD.hi[bank] = screenLCD.dirtyHi[bank];
+		if(screenLCD.dirtyLo[bank] > screenLCD.dirtyHi[bank]) continue;
+
+		end = bank*LCD_WIDTH + screenLCD.dirtyHi[bank] + 1;
+		for(i = bank*LCD_WIDTH + screenLCD.dirtyLo[bank]; i != end; i += n) {
+			n = (end - i > LCD_COPY_CHUNK) ? LCD_COPY_CHUNK : end - i;
+			start = LCD_CLOCK;
+			memcpy((uint8_t*)&frontLCD.screen[i], &screenLCD.screen[i], n);
+			cycles += (uint8_t)(LCD_CLOCK - start);
+		}
+		sent += screenLCD.dirtyHi[bank] - screenLCD.dirtyLo[bank] + 1;
+
+		screenLCD.dirtyLo[bank] = LCD_CLEAN;
+		screenLCD.dirtyHi[bank] = 0;
+	}
+
+	frontLCD.bank = 0;
+	frontLCD.step = 0;
+	frontLCD.sent = sent;
+	frontLCD.cycles = cycles * LCD_CLOCK_DIV;
+	if(!sent) return 1;
+
+	// First byte is sent from here, the rest from SPI_STC interrupt. The polled transfers of `screenLCDInit()`
+	// leave SPIF set - it's cleared first, or the interrupt would come at once and write SPDR while the
+	// first byte is still being shifted out
+	oldSREG = SREG;
+	cli();
+	frontLCD.busy = 1;
+	PORT_LCD &= ~(1<<LCD_SCE);
+	(void)SPSR;
+	(void)SPDR;
+	start = LCD_CLOCK;
+	spiNext();
+	frontLCD.cycles += (uint8_t)(LCD_CLOCK - start) * LCD_CLOCK_DIV;
+	SPCR |= (1<<SPIE);
+	SREG = oldSREG;
+
+	return 1;
+}
+
+void screenLCDRender(void) {
+	while(!screenLCDSwap());
+	while(frontLCD.busy);
+}
+#else
+void screenLCDRender(void) {
+	register uint8_t bank, x;
+	uint16_t sent = 0;
+	uint32_t cycles = 0;
+	uint8_t start;
+
+	for(bank = 0; bank != LCD_BANKS; ++bank) {
+		if(screenLCD.dirtyLo[bank] > screenLCD.dirtyHi[bank]) continue;  // Nothing changed in this bank
+
+		// Set column and row to the beginning of the changed span
+		start = LCD_CLOCK;
+		writeCmd(0x80 | screenLCD.dirtyLo[bank]);
+		writeCmd(0x40 | bank);
+		cycles += (uint8_t)(LCD_CLOCK - start);
+
+		// Write only the changed span to display, a byte is short enough to not overflow the 8 bit clock
+		for(x = screenLCD.dirtyLo[bank]; x <= screenLCD.dirtyHi[bank]; ++x) {
+			start = LCD_CLOCK;
+			writeData(screenLCD.screen[bank*LCD_WIDTH+x]);
+			cycles += (uint8_t)(LCD_CLOCK - start);
+		}
+		sent += screenLCD.dirtyHi[bank] - screenLCD.dirtyLo[bank] + 1;
+
+		screenLCD.dirtyLo[bank] = LCD_CLEAN;
+		screenLCD.dirtyHi[bank] = 0;
+	} 
+	
+	screenLCD.sent = sent;
+	screenLCD.cycles = cycles * LCD_CLOCK_DIV;
+}
+
+// Bit-banged transfer is blocking, so the frame is on the glass before this returns
+uint8_t screenLCDSwap(void) {
+	screenLCDRender();
+	return 1;
+}
+#endif
+
+uint16_t screenLCDSent(void) {return screenLCD.sent;}
+uint32_t screenLCDCycles(void) {return screenLCD.cycles;}
+
 
-const struct lcdInterface LCD = {
-	.init   = screenLCDInit,
-	.clear  = screenLCDClear,
-	.sendc  = screenLCDWriteChar,
-	.sends  = screenLCDWriteString,
-	.cursor = screenLCDSetCursor,
-	.render = screenLCDRender,
-	// .power = screenLCDPower,
-	// .setPixel = screenLCDSetPixel
-};
\ No newline at end of file
+#endif  // USE_PCD8544
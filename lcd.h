@@ -30,24 +30,60 @@
 #define PORT_LCD PORTB
 #define DDR_LCD  DDRB
 
+#ifndef LCD_USE_SPI
+    #define LCD_USE_SPI 0  // 1 - hardware SPI driven by SPI_STC interrupt;  0 - bit-banged transfer
+#endif
+
 // LCD's pins
-#define LCD_RST PB5  // RST
-#define LCD_SCE PB4  // CS
-#define LCD_DC  PB3  // D/C
-#define LCD_DIN PB2  // DIN
-#define LCD_CLK PB1  // CLK
+#if LCD_USE_SPI == 1
+    // DIN and CLK are fixed on MOSI/SCK, CS takes SS so the SPI unit stays a master.
+    // MISO is forced to input while SPI is on, so RST goes to a spare pin of PORTC
+    #define PORT_RST PORTC
+    #define DDR_RST  DDRC
+    #define LCD_RST PC0  // RST
+    #define LCD_SCE PB2  // CS
+    #define LCD_DC  PB1  // D/C
+    #define LCD_DIN PB3  // DIN
+    #define LCD_CLK PB5  // CLK
+#else
+    #define PORT_RST PORT_LCD
+    #define DDR_RST  DDR_LCD
+    #define LCD_RST PB5  // RST
+    #define LCD_SCE PB4  // CS
+    #define LCD_DC  PB3  // D/C
+    #define LCD_DIN PB2  // DIN
+    #define LCD_CLK PB1  // CLK
+#endif
 
 #define LCD_CONTRAST 0x40
 
-struct lcdInterface {
-    void (*init)(void);
-    void (*clear)(void)  __attribute__((optimize("-O3")));
-    void (*sendc)(char code, uint8_t scale);
-    void (*sends)(const char* word, uint8_t scale);
-    void (*cursor)(uint8_t xPos, uint8_t yPos);
-    void (*render)(void) __attribute__((optimize("-O3")));
-    // void (*power)(uint8_t on);
-    // void (*setPixel)(uint8_t xPos, uint8_t yPos, uint8_t value);
-}; extern const struct lcdInterface LCD;
+#define LCD_WIDTH 84    // Columns
+#define LCD_BANKS 6     // 8 pixel high rows
+#define LCD_CLEAN 0xFF  // Dirty span start of a bank that didn't change
+
+// Free-running TIMER2 counts CPU cycles spent on transfers. TIMER0 and TIMER1 tick every 64 cycles,
+// in step with the 128 cycle SPI byte, so every reading would be off the same way.
+// Its 8 bits only cover short spans - single interrupts and bytes, the frame copy in chunks
+#define LCD_CLOCK TCNT2
+#if LCD_USE_SPI == 1
+    #define LCD_CLOCK_CS  (1<<CS20)  // Prescaler 1
+    #define LCD_CLOCK_DIV 1
+#else
+    #define LCD_CLOCK_CS  (1<<CS21)  // Prescaler 8 - a bit-banged byte takes over 200 cycles
+    #define LCD_CLOCK_DIV 8
+#endif
+#define LCD_COPY_CHUNK 16  // Bytes copied into the front buffer per clock reading
+
+void screenLCDInit(void);
+void screenLCDClear(void) __attribute__((optimize("-O3")));
+void screenLCDPower(uint8_t on);
+void screenLCDSetPixel(uint8_t x, uint8_t y, uint8_t value);
+void screenLCDColumn(uint8_t x, uint8_t y, uint32_t bits, uint8_t height);
+void screenLCDBackground(const uint8_t *bitmap);  // Loads a whole 504 byte PROGMEM layer
+void screenLCDRestore(const uint8_t *bitmap, uint8_t x, uint8_t y, uint8_t width, uint8_t height);  // Restores banks under a rectangle from the layer
+void screenLCDRender(void) __attribute__((optimize("-O3")));
+uint8_t  screenLCDSwap(void);    // Hands drawn frame to the transport; 0 if previous one is still being sent
+uint16_t screenLCDSent(void);    // Bytes shifted out by the last frame
+uint32_t screenLCDCycles(void);  // CPU cycles spent on the last frame transfer
 
 #endif  // LCD_H
@@ -22,36 +22,32 @@
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
 #include <avr/eeprom.h>
+#include <avr/sleep.h>
 
 #include <util/delay.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
-#include "lcd.h"
+#include "display.h"
 #include "ftoa.h"
 #include "millis.h"
+#include "persist.h"
+#include "store.h"
+#include "sched.h"
+#include "dht.h"
+#include "probe.h"
+#include "telem.h"
+#include "speed.h"
+#include "screens.h"
+#include "trip.h"
 
 
 #define USE_DHT  1      // 1 - use DHT11 sensor;  0 - don't use DHT11 sensor
 
 #if USE_DHT == 1
-    #define MAX_TIMING 85
-
-    #define DHT_DDR  DDRD          
-    #define DHT_PORT PORTD
-    #define DHT_PIN  (1<<5)                    // PD5 as DHT11 pin
-
-    #define DHT_EN_OUT  DHT_DDR |= DHT_PIN     // PD5 as output
-    #define DHT_EN_INP  DHT_DDR &= ~DHT_PIN    // PD5 as input
-
-    #define DHT_LO   DHT_PORT &= ~DHT_PIN      // Low state on PD5
-    #define DHT_HI   DHT_PORT |= DHT_PIN       // High state on PD5
-
-    typedef struct {
-        float humidity;
-        float temperature;
-    } DHT; DHT dht;
+    DHT dht;
 #endif
 
 #define USE_ADC              1        // 0 - don't use ADC for fuel readings;  1 - use ADC for fuel readings
@@ -60,102 +56,147 @@
 #define SAVE_INTERVAL        60       // Save data to EEPROM every X seconds
 #define USE_INTERNAL_EEPROM  1        // 1 - use ATMega's internal EEPROM to save data;  0 - use external 24AA01/24LC01B EEPROM
 
-#define USE_PCD8544          1        // 1 - use PCD8544 LCD screen;   0 - don't use PCD8544 LCD screen
-#define USE_SSD1327          0        // 1 - use SSD1327 OLED screen;  0 - don't use SSD1327 OLED screen
 
 #define NEXT_BTN         (1<<7)       // Navigation button
 #define BACK_BTN         (1<<0)       // Navigation button
 #define FUNC_BTN         (1<<6)       // Navigation button           
 
-#define SAVE_FLAG 213742069           // Known value stored in EEPROM to confirm, that data we read is valid
+#define SAVE_FLAG 0x71F5              // Known value stored in EEPROM to confirm, that data we read is valid - low word of 213742069
 
+// Layout of the EEPROM, stored with the settings - `loadData()` converts or drops anything else
+#define EEPROM_FORMAT 2               // Settings below, trip in the record ring of `store.c`
 
+#define PROBE_MODE 6                  // Hidden diagnostics screen - hold FUNC on the acceleration screen
 
-static float PULSE_DISTANCE  = 0.0f;  // 0.00006823
-static float INJECTION_VALUE = 0.0f;  // (Polo, AAV - 0.002583f) 0.0025f - based on value that injector can inject 149.8 cc/min of fuel
+_Static_assert(TRIP_TICKS_PER_SECOND == SCHED_HZ, "Trip math assumes the TIMER1 tick rate");
 
 
-volatile static float avgSpeedDivider = .0, 
-                      traveledDistance = .0, 
-                      sailingDistance = .0, 
-                      sumInv = .0, accTime = .0;
 
-volatile static float instantFuelConsumption = .0, 
-                      averageFuelConsumption = .0, 
-                      usedFuel = .0, fuelLeft = .0, 
-                      fuelSumInv = .0, divideFuelFactor = .0, 
-                      savedFuel = .0;
+// Calibration values are kept in EEPROM as floats and turned into trip scale factors by `tripCalibrate()`:
+// pulse distance (0.00006823 km) and injection value ((Polo, AAV - 0.002583f) 0.0025f - based on value that injector can inject 149.8 cc/min of fuel)
+volatile static float divideFuelFactor = .0, ccMin = 100.0;
 
-volatile static float injectorOpenTime = .0, ccMin = 100.0;
-
-#ifdef SAVE_INTERVAL
-    volatile static uint8_t saveCounter = SAVE_INTERVAL;
-#else 
-    volatile static uint8_t saveCounter = 60
-#endif
+volatile static long fuelLeft = 0, savedFuel = 0;   // mL
+static uint16_t fuelAdc = 0;                         // Last fuel level reading
 
 volatile static uint8_t btnCnt = 24, 
                         calibrationFlag = 0, pulseOverflows = 0, 
-                        mode = 3, accBuffer = 0;
+                        mode = 3, accBuffer = 0, 
+                        accTime = 0;  // 0.25s ticks
+
+static uint8_t shownScreen = 0;      // Screen whose static layer is on the LCD, 0 - none
+static uint8_t holdMode = 0;         // Screen the function button has been pressed on
+static uint8_t holdChord = 0;        // NEXT or BACK pressed with it - a chord, the hold does nothing
+
+// Reasons to draw a new frame, published by ISRs and tasks
+#define EVENT_TICK   (1<<0)           // 0.25s tick
+#define EVENT_SECOND (1<<1)           // Speed, consumption and averages recalculated
+#define EVENT_NAV    (1<<2)           // Button pressed, screen or calibration value changed
+#define EVENT_SPEED  (1<<3)           // Shown speed changed, checked SPEED_HZ times a second
+
+volatile static uint8_t frameEvents = EVENT_NAV;
+static uint8_t drawEvents = 0;        // Events of the frame being drawn
+
+volatile static uint16_t distPulseCount = 0;      // 16 bits as on the AVR - calibration counts its wraps
+volatile unsigned int rangeDistance = 0;         // km - not static, so the host replay can log it
+static uint8_t rangeWindow = TRIP_WINDOW_TRIP;    // Consumption window the range is computed from
+
+volatile static unsigned long int injectorPulseTime = 0;  // Injector open time in the current second, TIMER0 ticks
+
+// ISRs only count and capture - work published here is done in the main loop
+volatile static uint8_t pendingTicks = 0, pendingButtons = 0;
+volatile static unsigned int tickPulses = 0;              // Counts of finished ticks
+volatile static unsigned long int tickInjTime = 0;
 
-volatile static uint8_t speed = 0, avgSpeedCount = 0;
+static unsigned int tripPulses = 0;                       // Counts waiting for the trip task
+static unsigned long int tripInjTime = 0;
+static uint8_t tripTicks = 0;
 
-volatile static unsigned int counter = 4, distPulseCount = 0, 
-                             injectorPulseTime = 0, injTimeHigh = 0, 
-                             injTimeLow = 0, rangeDistance = 0,  
-                             saveFlag = 0; // uint16_t
+static unsigned int lastPulses = 0;                       // Last second handled by the trip task
+static unsigned long int lastInjTime = 0;
 
+static uint8_t taskEvents = 0;                            // Frame events published by tasks
 
-// Structure stored in EEPROM
+
+// Settings stored in EEPROM - trip state goes to the record ring of `store.c`
 typedef struct {
-    float eeAverageFuelConsumption;
-    float eeTraveledDistance;
-    float eeUsedFuel;
-    float eeSavedFuel;
     float eeDivideFuelFactor;
-    float eeAvgSpeedDivider;
     float eePulseDistance;
-    float eeSumInv;
-    float eeFuelSumInv;
     float eeInjectionValue;
-    uint8_t eeAverageSpeedCount;  
-    int   eeSaveFlag;
+    uint16_t eeSaveFlag;
+    uint16_t eeFormat;
 } eeStruct;
 
+// Everything the first firmware saved, one struct at the start of EEPROM - where `eeSavedData` is now
+typedef struct {
+    float avgFuel;                    // L/100km
+    float distance;                   // km
+    float usedFuel;                   // L
+    float savedFuel;                  // L
+    float divideFuelFactor;
+    float avgSpeedDivider;
+    float pulseDistance;
+    float sumInv;
+    float fuelSumInv;
+    float injectionValue;
+    uint8_t avgSpeedCount;
+    uint16_t saveFlag;
+} __attribute__((packed)) eeLegacy;
+
 #if USE_INTERNAL_EEPROM == 1
 eeStruct EEMEM eeSavedData;
 #else
 eeStruct eeSavedData;
 #endif
 
+// Settings as last queued for EEPROM - shown by the calibration screen, written again only when they change
+static eeStruct settings;
 
-#if USE_DHT == 1
-__attribute__((always_inline)) static void startTempRead() {
-    DHT_EN_OUT;
-    DHT_LO;
-} static void tempRead();     __attribute__((optimize("-O3")));     // Reading from this sensor is a heavy task while still doing the rest of the tasks
-#endif
-
-static void avgSpeed()        __attribute__((optimize("-O3")));     // We want to ensure high level of optimization
-static void currentSpeed()    __attribute__((optimize("-O3")));     // And also we're looking for speed in case of ATMega 328P
+// Pulse distance, injection value and the save flag go to EEPROM as one record, values first
+#define CALIBRATION_BYTES (offsetof(eeStruct, eeFormat) - offsetof(eeStruct, eePulseDistance))
 
-static void fuelConsumption() __attribute__((optimize("-O3")));     // Those attributes are compiler dependent - they work with `gcc`
 
-static void saveData();
+static uint8_t saveData();
 static void loadData();
 
-#if USE_INTERNAL_EEPROM == 1
-__attribute__((always_inline)) static inline void checkSaveFlag() {
-    // Simple check if there was data saved to EEPROM earlier
-    // We don't want to load garbage data
+static void buttonWork(uint8_t buttons);
 
-    if(isnan(eeprom_read_word(&eeSavedData.eeSaveFlag))) saveFlag = 0;
-    else saveFlag = eeprom_read_word(&eeSavedData.eeSaveFlag);
-}
-#else
-__attribute__((always_inline)) static inline void checkSaveFlag() {return;}
+static void tripTask(void);
+static void accelerationTask(void);
+static void holdTask(void);
+static void saveTask(void);
+#if USE_TELEMETRY == 1
+static void telemTick(uint8_t ticks, unsigned int pulses, unsigned long int injTime);
+#endif
+#if USE_DHT == 1
+static void dhtStartTask(void);
+static void dhtListenTask(void);
+static void dhtDecodeTask(void);
 #endif
 
+// Work done from the main loop, in 0.25s ticks
+enum {TASK_TRIP, TASK_ACCELERATION, TASK_HOLD, TASK_SAVE, TASK_DHT_START, TASK_DHT_LISTEN, TASK_DHT_DECODE};
+
+static const schedTask TASKS[] PROGMEM = {
+    {tripTask,         4,                 4},
+    {accelerationTask, 1,                 1},
+    {holdTask,         1,                 1},
+    {saveTask,         SAVE_INTERVAL*4,   SAVE_INTERVAL*4},
+    #if USE_DHT == 1
+    {dhtStartTask,     4,                 1},
+    {dhtListenTask,    0,                 0},  // 0.25s after the start - WITHOUT `_delay_ms(25)`
+    {dhtDecodeTask,    0,                 0}   // Frame takes ~5ms, edges are collected by PCINT2
+    #endif
+};
+
+static void drawScreen(uint8_t mode, uint8_t events);
+static void drawCalibration(uint8_t mode);
+#if USE_PROBE == 1
+static void drawProbe(void);
+#endif
+static void drawFrame(void);
+static void saveCalibration(void);
+
 int main() {
     // (2021.02.01) - I use hex values 'cause they take less space in the output file. 
     // (2021.02.07) - For now, (commit on GH no. 6adcdef, as I write this) there are 224 bytes of free space in flash memory.
@@ -201,13 +242,9 @@ int main() {
 
 
     // 16 bit timer for VSS
-    #define CLOCK_START 3036
-    TCCR1A = 0;                          // Timer1 normal mode
-    TCCR1B |= ((1<<CS10) | (1<<CS11));   // Prescaler 64, causes overflow every 0.262144s (16 MHz crystal, 0.524288s for 8 MHz)
-    TIMSK1 |= (1<<TOIE1);                // Enable timer overflow interrupt
-    TCNT1 = CLOCK_START;                 // Counts from 3036 to 65535 - causes overflow every 0.25s (16 MHz crystal, 34286 for 8 MHz)
+    schedTimerInit();
 
-    // Counter for millis() function
+    // Counter for millis() function and injector timing
     TCCR0B |= ((1<<CS01) | (1<<CS00));   // Prescaler 64
     TIMSK0 = (1<<TOIE0);                 // Enable timer overflow interrupt
     TCNT0 = 0;                           // Counts from 0 to 255;
@@ -217,27 +254,43 @@ int main() {
 	uint8_t i = 15;                      // Counter and mode iterators
 	uint8_t buttonPressed = 0;           // Keeps track if button is pressed; 0 false, 1 true
 
+    uint8_t ticksDue, buttons;
+    unsigned int pulses;
+    unsigned long int injTime;
+
 
-    // checkSaveFlag();
-    // if(saveFlag == SAVE_FLAG) 
     loadData(); // Loads data from EEPROM
                
-    char buffer[8], res[8];               // Buffer for itoa() function
-    LCD.init();
+    uint8_t events, pendingSwap = 0;
+    displayInit();
+    schedInit(TASKS, sizeof(TASKS)/sizeof(schedTask));
+
+    set_sleep_mode(SLEEP_MODE_IDLE);      // Timers, SPI and external interrupts keep running while we sleep
+
+    #if USE_PROBE == 1
+    probeReset();
+    #endif
+
+    #if USE_TELEMETRY == 1
+    telemInit();
+    #endif
 
     sei();                                // Global interrupts enabled
     while(1) {
+        events = 0;
+
         #if USE_ADC == 1
         if(fuelLeft <= 0) {
             // ADC checks for level fuel in the tank
             ADCSRA |= (1<<ADSC);
             while(ADCSRA & (1<<ADSC));
-            fuelLeft = (ADC > 0 
-                            ? (divideFuelFactor > 0 ? ADC/divideFuelFactor : 0)
-                            : savedFuel-usedFuel);
+            fuelAdc = ADC;
+            fuelLeft = (fuelAdc > 0 
+                            ? (divideFuelFactor > 0 ? (long)(fuelAdc*1000L/divideFuelFactor) : 0)
+                            : savedFuel-(long)tripFuel());
         }
         #else
-            fuelLeft = 40;
+            fuelLeft = 40000;
         #endif
         
         if(!(PIND & (1<<PD6)) && !buttonPressed) {
@@ -249,448 +302,703 @@ int main() {
 
             if(calibrationFlag == 1 && mode == 2) {
                 divideFuelFactor += 0.5f;
-                eeprom_update_float(&eeSavedData.eeDivideFuelFactor, divideFuelFactor);
+                settings.eeDivideFuelFactor = divideFuelFactor;
+                persistWrite(&eeSavedData.eeDivideFuelFactor, &settings.eeDivideFuelFactor, sizeof(float));
+                events = EVENT_NAV;
             }
         } else if((PIND & (1<<PD6)) && buttonPressed) {
             buttonPressed = 0;
             PORTD ^= (1<<PD6);
         } 
-        
-        if(!calibrationFlag) {
-            switch(mode) {
-                case 5:
-                // Fuel infoscreen
-
-                    // Used fuel
-                    ftoa(usedFuel, res, 2);
-                    LCD.cursor(1, 1); LCD.sends("&$  ", 1);  // Range symbol
-                    if(usedFuel <= 0) LCD.sends("--.-", 1);
-                    else if(usedFuel < 1 && usedFuel > 0) {LCD.sends("0", 1); LCD.sends(res, 1);}
-                    else LCD.sends(res, 1);
-                    LCD.cursor(65, 1); LCD.sends(" L", 1);
-                    LCD.cursor(1, 9); LCD.sends("--------------", 1);
-                    
-                    // Traveled distance without burning fuel
-                    ftoa(sailingDistance, res, 1);   
-                    LCD.cursor(1, 17);
-                    if(sailingDistance <= 0) LCD.sends("--", 2);
-                    else if(sailingDistance > 0 && sailingDistance < 1) {LCD.sendc('0', 2); LCD.sends(res, 2);}
-                    else LCD.sends(res, 2);
-                    LCD.cursor(55, 22); LCD.sends("KM(S)", 1);
-
-                    // Left fuel
-                    ftoa(fuelLeft, res, 0); 
-                    LCD.cursor(1, 32); LCD.sends("--------------", 1);
-                    LCD.cursor(5, 40); LCD.sends("!\"   ", 1);  // Fuel distributor symbol
-                    LCD.sends(res, 1); 
-                    LCD.cursor(70, 40); LCD.sends("L", 1);
-                break;
 
-                case 4:
-                // Speed infoscreen
-                    ftoa(speed, res, 2);
-
-                    // Current speed  
-                    LCD.cursor(6, 7); 
-                    if(speed <= 0) LCD.sends("--", 2);
-                    else if(speed < 1 && speed > 0) {LCD.sends("0", 2); LCD.sends(itoa(speed, buffer, 10), 2);}
-                    else LCD.sends(itoa(speed, buffer, 10), 2);
-                    LCD.cursor(56, 11); LCD.sends("KM/H", 1);
-
-                    // Acceleration time
-                    LCD.cursor(1, 32); LCD.sends("--------------", 1);
-                    LCD.cursor(5, 40); LCD.sends("   ", 1);
-                    ftoa(accTime, res, 1);
-                    if(accTime <= 0) LCD.sends("--.-", 1);
-                    else LCD.sends(res, 1);
-                    LCD.cursor(56, 40); LCD.sends("  S", 1);
-                break;
+        PROBE_START(cliStart);
+        cli();
+        events |= frameEvents;
+        frameEvents = 0;
+        ticksDue = pendingTicks;
+        pendingTicks = 0;
+        buttons = pendingButtons;
+        pendingButtons = 0;
+        pulses = tickPulses;
+        injTime = tickInjTime;
+        tickPulses = 0;
+        tickInjTime = 0;
+        PROBE_END(PROBE_CLI, cliStart, 0);
+        sei();
+
+        // Bottom half of the ISRs, with interrupts enabled
+        if(buttons) buttonWork(buttons);
+        if(ticksDue) {
+            tripPulses += pulses;
+            tripInjTime += injTime;
+            tripTicks += ticksDue;
+            schedTicks(ticksDue);
+
+            #if USE_TELEMETRY == 1
+            telemTick(ticksDue, pulses, injTime);
+            #endif
+        }
 
-                case 3: 
-                // Main Screen                    
-                    // Range
-                    LCD.cursor(1, 1); LCD.sends("$%& ", 1);  // Range symbol
-                    if(rangeDistance > 100) {LCD.sendc(' ', 1); LCD.sends(itoa(rangeDistance, buffer, 10), 1);}
-                    else {
-                        LCD.sends("-(", 1);
-                        LCD.sends(itoa(rangeDistance, buffer, 10), 1);
-                        LCD.sends(")-", 1);
-                    }
-                    LCD.cursor(65, 1); LCD.sends(" KM", 1);
-                    LCD.cursor(1, 9); LCD.sends("--------------", 1);
-                    
-                    // Instant fuel consumption
-                    ftoa(instantFuelConsumption, res, 1);   
-                    LCD.cursor(1, 17);
-                    if(instantFuelConsumption > 99 || instantFuelConsumption <= 0) LCD.sends("--.-", 2);
-                    else LCD.sends(res, 2);
-
-                    LCD.cursor(54, 22);
-                    if(speed > 5) LCD.sends("L/100", 1);     // Car is moving
-                    else LCD.sends("L/H", 1);                // Car is not moving
-
-                    // Average fuel consumption
-                    LCD.cursor(1, 32); LCD.sends("--------------", 1);
-                    LCD.cursor(5, 40); LCD.sends("#  ", 1);  // Average fuel consumption symbol
-                    
-                    ftoa(averageFuelConsumption, res, 1);
-                    if(averageFuelConsumption <= 0) LCD.sends("--.-", 1);
-                    else LCD.sends(res, 1); 
-                    LCD.cursor(54, 40); LCD.sends("L/100", 1);
-                break;
+        if(speedUpdate()) events |= EVENT_SPEED;
 
-                case 2: 
-                // Speed infoscreen
-                    ftoa(speed, res, 2);
-
-                    // Current speed  
-                    LCD.cursor(6, 7); 
-                    if(speed <= 0) LCD.sends("--", 2);
-                    else if(speed < 1 && speed > 0) {LCD.sends("0", 2); LCD.sends(itoa(speed, buffer, 10), 2);}
-                    else LCD.sends(itoa(speed, buffer, 10), 2);
-                    LCD.cursor(56, 11); LCD.sends("KM/H", 1);
-
-                    // Average speed
-                    LCD.cursor(1, 32); LCD.sends("--------------", 1);
-                    LCD.cursor(5, 40); LCD.sends("#  ", 1);  // Average speed symbol
-                    if(avgSpeedCount <= 0) LCD.sends("--", 1);
-                    else LCD.sends(itoa(avgSpeedCount, buffer, 10), 1);
-                    LCD.cursor(56, 40); LCD.sends("KM/H", 1);
-                break;
+        events |= taskEvents;
+        taskEvents = 0;
 
+        if(events) {
+            if(calibrationFlag && mode == 1) saveCalibration();
 
-                case 1:
-                // Fuel infoscreen
+            drawEvents = events;
+            PROBE_FRAME_START(frameStart);
+            displayDraw(drawFrame);
+            PROBE_FRAME_END(frameStart, ticksDue > 1 ? ticksDue-1 : 0);
+            pendingSwap = 1;
+        }
 
-                    // Used fuel
-                    ftoa(usedFuel, res, 2);
-                    LCD.cursor(1, 1); LCD.sends("&$  ", 1);  // Range symbol
-                    if(usedFuel <= 0) LCD.sends("--.-", 1);
-                    else if(usedFuel < 1 && usedFuel > 0) {LCD.sends("0", 1); LCD.sends(res, 1);}
-                    else LCD.sends(res, 1);
-                    LCD.cursor(65, 1); LCD.sends(" L", 1);
-                    LCD.cursor(1, 9); LCD.sends("--------------", 1);
-                    
-                    // Traveled distance
-                    ftoa(traveledDistance, res, 1);   
-                    LCD.cursor(1, 17);
-                    if(traveledDistance <= 0) LCD.sends("--", 2);
-                    else if(traveledDistance > 0 && traveledDistance < 1) {LCD.sendc('0', 2); LCD.sends(res, 2);}
-                    else LCD.sends(res, 2);
-                    LCD.cursor(70, 22); LCD.sends("KM", 1);
-
-                    // Left fuel
-                    ftoa(fuelLeft, res, 0); 
-                    LCD.cursor(1, 32); LCD.sends("--------------", 1);
-                    LCD.cursor(5, 40); LCD.sends("!\"   ", 1);  // Fuel distributor symbol
-                    LCD.sends(res, 1); 
-                    LCD.cursor(70, 40); LCD.sends("L", 1);
-                break;
+        // Transport may still be busy with the previous frame - try again on the next wake up
+        if(pendingSwap && displaySwap()) pendingSwap = 0;
+
+        // Sleep until the next interrupt, unless it has already published something
+        cli();
+        if(!frameEvents) {
+            sleep_enable();
+            sei();
+            sleep_cpu();
+            sleep_disable();
+        } sei();
+    } return 0;
+}
 
-                // `switch()` without `default` case is taking more space in output file. Huh, interesting.
-                default: 
-                    LCD.cursor(1, 1); LCD.sends("L//M - ", 1); 
-                    LCD.sends(itoa(mode, buffer, 10), 1);
-                break;
-            }
-        } else {
-            switch(mode) {
-                case 1: 
-                    cli();  // Disable global interrupts to not corrupt the data
 
-                    // Simple formula - distance/pulses
-                    float ff = 65535*pulseOverflows;
-                          ff += distPulseCount;
-                          ff = 10/ff; 
 
-                    float inv = ccMin/1000;
-                          inv = inv/60;
+ISR(TIMER1_COMPA_vect) {
+    PROBE_START(start);
+    schedCompare();
+    ++pendingTicks;
+    frameEvents |= EVENT_TICK;
+    if(!(PIND & (1<<PD6))) frameEvents |= EVENT_NAV;
 
-                    // Calibration data is stored in EEPROM
-                    eeprom_update_float(&eeSavedData.eePulseDistance,  ff);
-                    eeprom_update_float(&eeSavedData.eeInjectionValue, inv);
-                    eeprom_update_word(&eeSavedData.eeSaveFlag, SAVE_FLAG);
+    // Counts of the tick that has just finished - pulses counted for calibration are not a trip
+    if(!calibrationFlag) {
+        tickPulses += distPulseCount;
+        distPulseCount = 0;
+    }
+    tickInjTime += injectorPulseTime;
+    injectorPulseTime = 0;
+    PROBE_END(PROBE_TIMER1, start, TIFR1 & (1<<OCF1A));
+}
 
-                    LCD.sends("L//K", 1);
-                    LCD.cursor(0, 9);
-                    ftoa(ff, res, 8);
-                    LCD.sends(res, 1);
 
-                    LCD.cursor(0, 18);
-                    ftoa(inv, res, 8);
-                    LCD.sends(res, 1);
-                    
-                    sei();
-                break;
+// VSS signal interrupt
+ISR(INT0_vect) {
+    PROBE_START(start);
+    ++distPulseCount;
+    speedEdge();
+    if(calibrationFlag && !distPulseCount) ++pulseOverflows;
+    PROBE_END(PROBE_INT0, start, EIFR & (1<<INTF0));
+}
 
-                case 2:
-                    ftoa(ccMin, res, 1);
-                    LCD.cursor(0, 1); LCD.sends("50: ", 1);
-                    LCD.sends(res, 1);
-                    
-                    ftoa(divideFuelFactor, res, 1);
-                    LCD.cursor(0, 9); LCD.sends("55: ", 1);
-                    LCD.sends(res, 1);
-                break;
+// Injector signal interrupt 
+ISR(INT1_vect) {
+    static uint32_t injTimeLow = 0;
+    static uint8_t injOpen = 0;
+    uint32_t now = ticks();
+    PROBE_START(start);
+
+    if(!(PIND & (1<<PD3))) {
+        // Low state on PD3 - injector opens
+        injTimeLow = now;
+        injOpen = 1;
+    } else if(injOpen) {
+        // High state on PD3 - unsigned difference stays right when the tick counter wraps
+        injectorPulseTime += now - injTimeLow;
+        injOpen = 0;
+        PORTD |= (1<<PD3);
+    }
+    PROBE_END(PROBE_INT1, start, EIFR & (1<<INTF1));
+}
 
-                case 3: 
-                    sei();
-                    LCD.cursor(0, 1); LCD.sends("40: ", 1);
-                    LCD.sends(ltoa(distPulseCount, buffer, 10), 1);
-                    
-                    LCD.cursor(0, 9); LCD.sends("41: ", 1);
-                    LCD.sends(itoa(pulseOverflows, buffer, 10), 1);
-                break;
-            }
-        }
 
-        LCD.render();
-        LCD.clear();
-    } return 0;
+// Navigation buttons - Atmega 328
+ISR(PCINT0_vect) {
+    PROBE_START(start);
+    if(!(PINB & (1<<PB0))) {
+        // Low state on PB0
+        pendingButtons |= BACK_BTN;
+        frameEvents |= EVENT_NAV;
+    } 
+    PROBE_END(PROBE_PCINT0, start, PCIFR & (1<<PCIF0));
+}
+
+ISR(PCINT2_vect) {
+    static uint8_t last = 0xFF;
+    uint8_t pins = PIND;
+    PROBE_START(start);
+    uint8_t fell = last & ~pins;       // PD7 and PD5 share this interrupt - look for the pin that went low
+
+    last = pins;
+
+    #if USE_DHT == 1
+    if(fell & DHT_PIN) dhtEdge();
+    #endif
+
+    if(fell & (1<<PD7)) {
+        // Low state on PD7
+        pendingButtons |= NEXT_BTN;
+        frameEvents |= EVENT_NAV;
+    } 
+    PROBE_END(PROBE_PCINT2, start, PCIFR & (1<<PCIF2));
 }
 
 
+// Button presses published by PCINT ISRs
+void buttonWork(uint8_t buttons) {
+    uint8_t func = !(PIND & (1<<PD6));
+
+    if(func && buttons) holdChord = 1;
 
-ISR(TIMER1_OVF_vect) {
-    --counter;
+    if(buttons & BACK_BTN) {
+        if(calibrationFlag == 1 &&  mode == 2 && func) ccMin -= 0.5f;
+        else if(calibrationFlag == 1 && mode == 3 && func) {cli(); distPulseCount -= 500; sei();}
+        else if(calibrationFlag == 0 && mode == 1 && func) {
+            fuelLeft -= 500;
+            savedFuel = fuelLeft;
+            schedAfter(TASK_SAVE, 1);  // Saved with the trip, as soon as it's allowed
+        } else if(calibrationFlag == 0 && mode == 3 && func) rangeWindow = (rangeWindow == 0) ? TRIP_WINDOWS-1 : rangeWindow-1;
+        else mode = (mode > 3) ? 1 : mode+1;
+    }
+
+    if(buttons & NEXT_BTN) {
+        if(calibrationFlag == 1 && mode == 2 && func) ccMin += 0.5f;
+        else if(calibrationFlag == 1 && mode == 3 && func) {cli(); distPulseCount += 500; sei();}
+        else if(calibrationFlag == 0 && mode == 1 && func) {
+            fuelLeft += 500;
+            savedFuel = fuelLeft;
+            schedAfter(TASK_SAVE, 1);  // Saved with the trip, as soon as it's allowed
+        } else if(calibrationFlag == 0 && mode == 3 && func) rangeWindow = (rangeWindow + 1 == TRIP_WINDOWS) ? 0 : rangeWindow+1;
+        else mode = (mode < 2) ? 3 : mode-1;
+    }
+}
 
-    // Acceleration from 0 to 100 km/h measure time
-    if(speed > 0 && speed < 100) ++accBuffer;
-    if(speed >= 100) accTime = (float)accBuffer/4.0f; 
+// Speed, consumption and averages
+void tripTask(void) {
+    uint16_t avgFuel;
 
-    // Data saving based on speed and time
-    if(saveCounter <= 0 && injectorPulseTime < 800 && distPulseCount == 0) saveData();
-    if(saveCounter <= 0 && speed == 0) saveData();
+    lastPulses = tripPulses;
+    lastInjTime = tripInjTime;
 
+    fuelLeft -= tripUpdate(tripPulses, tripInjTime, tripTicks);
+    tripPulses = 0;
+    tripInjTime = 0;
+    tripTicks = 0;
+
+    // Until the selected window has seen enough distance, range comes from the trip average
+    avgFuel = tripWindow(rangeWindow);
+    if(!avgFuel) avgFuel = tripNow.avgFuel;
+    if(tripNow.speed > 5 && avgFuel > 0) rangeDistance = fuelLeft*10/avgFuel;  // mL and 0.01 L/100km to km
+
+    taskEvents |= EVENT_SECOND;
+
+    #if USE_PROBE == 1
+    probeSecond();
+    #endif
+}
+
+// Acceleration from 0 to 100 km/h measure time
+void accelerationTask(void) {
+    if(speedNow.speed == 0) accBuffer = 0;
+    if(speedNow.speed > 0 && speedNow.speed < 1000) ++accBuffer;
+    if(speedNow.speed >= 1000) accTime = accBuffer; 
+}
+
+// Function button held down
+void holdTask(void) {
     if(!(PIND & (1<<PD6))) {
+        if(btnCnt == 24) holdMode = mode;
         --btnCnt;
+        if(holdChord) return;
 
-        if(calibrationFlag == 0 && (btnCnt <= 20 && btnCnt > 0)) {
+        if(calibrationFlag == 0 && btnCnt == 20) {
             // Check if button is pressed for ~1 second
             switch(mode) {
                 case 2: mode = 4; break;
                 case 1: mode = 5; break;
+                #if USE_PROBE == 1
+                case 4: mode = PROBE_MODE; break;
+                #endif
             }
 
-        } else if(calibrationFlag == 0 && (btnCnt <= 12 && btnCnt > 0)) {
-            // Check if button is pressed for ~3 seconds
-            switch(mode) {
+        } else if(calibrationFlag == 0 && btnCnt == 12) {
+            // Check if button is pressed for ~3 seconds - resets the screen it was pressed on,
+            // the 1 second hold has already switched away from it
+            switch(holdMode) {
                 case 3: 
-                    averageFuelConsumption = .0f;
+                    trip.avgFuelTicks = 0;
+                    trip.avgPulses = 0;
+                    tripAverages();
 
                     saveData();
-                    loadData();
                 break;
 
                 case 2: 
-                    avgSpeedCount = 0;
+                    trip.speedInvSum = 0;
+                    trip.speedSamples = 0;
+                    tripAverages();
 
+                    mode = holdMode;
                     saveData();
-                    loadData();
                 break;
 
                 case 1: 
-                    usedFuel = .0f;
-                    traveledDistance = .0f;
+                    trip.fuelTicks = 0;
+                    trip.pulses = 0;
                     
+                    mode = holdMode;
                     saveData();
-                    loadData();
                 break;
             }
         } 
         
         // Check if button is pressed for ~6 seconds on the first screen
         if(btnCnt <= 0 && calibrationFlag == 0 && mode == 3) calibrationFlag = 1;
-    } else btnCnt = 24;
+    } else {
+        btnCnt = 24;
+        holdChord = 0;
+    }
+}
 
-    // 25ms of delay between initializing the sensor and data read - WITHOUT `_delay_ms(25)`
-    if(counter == 4) startTempRead();
-    if(counter == 3) tempRead();
+// Data saving based on speed and time
+void saveTask(void) {
+    uint8_t stopped = (lastInjTime < MS_TO_TICKS(800) && lastPulses == 0) || tripNow.speed == 0;
 
-    if(counter <= 0) {
-        currentSpeed();
-        fuelConsumption();
+    // Try again on the next tick
+    if(!stopped || !saveData()) schedAfter(TASK_SAVE, 1);
+}
 
-        if(speed <= 0) accBuffer = 0;
-        if(speed > 5) {
-            rangeDistance = (fuelLeft/averageFuelConsumption)*100;
-            ++avgSpeedDivider;
-            avgSpeed();
-        }
+#if USE_DHT == 1
+void dhtStartTask(void) {
+    dhtStart();
+    schedAfter(TASK_DHT_LISTEN, 1);
+}
 
-        if(saveCounter > 0) --saveCounter;
-        if(!calibrationFlag) distPulseCount = 0;
-        injectorPulseTime = 0;
-        counter = 4;
-    } TCNT1 = CLOCK_START;
+void dhtListenTask(void) {
+    dhtListen();
+    schedAfter(TASK_DHT_DECODE, 1);
 }
 
+void dhtDecodeTask(void) {dhtDecode(&dht);}
+#endif
 
-// VSS signal interrupt
-ISR(INT0_vect) {
-    ++distPulseCount;
-    if(calibrationFlag && distPulseCount == 65535) ++pulseOverflows;
+#if USE_TELEMETRY == 1
+// Counts of the ticks just handled - a full buffer only drops the frame, it's counted in the next one
+void telemTick(uint8_t ticks, unsigned int pulses, unsigned long int injTime) {
+    telemFrame frame;
 
-    traveledDistance += PULSE_DISTANCE;
-    if(instantFuelConsumption <= 0) sailingDistance += PULSE_DISTANCE;
+    frame.ticks = ticks;
+    frame.pulses = pulses;
+    frame.injTicks = injTime;
+    frame.speed = speedNow.speed;
+    frame.flags = (calibrationFlag ? TELEM_CALIBRATION : 0) | (!(PIND & (1<<PD6)) ? TELEM_FUNC : 0);
+    frame.adc = fuelAdc;
+
+    telemSend(&frame);
 }
+#endif
 
-// Injector signal interrupt 
-ISR(INT1_vect) {
-    if(!(PIND & (1<<PD3))) injTimeLow = millis();  // Low state on PD3
+
+
+
+// Dynamic fields - static labels around them are pre-rendered in `screens.h`
+#define FIELD_TEXT 10
+
+#define FIELD_STALE 0xFF
+
+static char fieldText[4][FIELD_TEXT];  // Text drawn by every field of the shown screen
+
+typedef struct {
+    uint8_t x, y, width, height;
+    uint8_t scale;
+    uint8_t events;             // Frame events after which the field is refreshed
+    void (*format)(char*);
+} field;
+
+typedef struct {
+    const uint8_t *background;
+    const field *fields;
+    uint8_t count;
+} screen;
+
+
+static void formatUsedFuel(char *text) {
+    uint32_t used = tripFuel();
+
+    if(used < 5) strcpy(text, "--.-");
+    else fixtoa(used, 3, 2, 0, text);
+}
+
+static void formatDistance(char *text, uint32_t distance) {
+    if(distance < 50) strcpy(text, "--");
+    else fixtoa(distance, 3, 1, 0, text);
+}
+static void formatTraveledDistance(char *text) {formatDistance(text, tripDistance());}
+static void formatSailingDistance(char *text)  {formatDistance(text, tripSailingDistance());}
+
+static void formatFuelLeft(char *text) {fixtoa(fuelLeft, 3, 0, 0, text);}
+
+static void formatSpeed(char *text) {
+    if(speedNow.speed < 10) strcpy(text, "--");
+    else itoa(speedNow.speed / 10, text, 10);
+}
+
+static void formatAccTime(char *text) {
+    if(accTime <= 0) strcpy(text, "--.-");
+    else fixtoa(accTime*25, 2, 1, 0, text);
+}
+
+static void formatAvgSpeed(char *text) {
+    if(tripNow.avgSpeed <= 0) strcpy(text, "--");
+    else itoa(tripNow.avgSpeed, text, 10);
+}
+
+static void formatRange(char *text) {
+    static const char *const WINDOWS[TRIP_WINDOWS] = {"TRIP", "1KM", "10KM", "100KM", "5MIN"};
+    char buffer[8];
+
+    // Window is shown while FUNC is held, BACK and NEXT change it
+    if(!(PIND & (1<<PD6))) {strcpy(text, WINDOWS[rangeWindow]); return;}
+
+    itoa(rangeDistance, buffer, 10);
+    if(rangeDistance > 100) {text[0] = ' '; strcpy(text+1, buffer);}
     else {
-        // High state on PD3
-        injTimeHigh = millis();
-        injectorPulseTime = injectorPulseTime + (injTimeHigh - injTimeLow);
-        PORTD |= (1<<PD3);
+        strcpy(text, "-(");
+        strcat(text, buffer);
+        strcat(text, ")-");
     }
 }
 
+static void formatInstantFuel(char *text) {
+    if(tripNow.instantFuel > 9900 || tripNow.instantFuel < 5) strcpy(text, "--.-");
+    else fixtoa(tripNow.instantFuel, 2, 1, 0, text);
+}
 
-// Navigation buttons - Atmega 328
-ISR(PCINT0_vect) {
-    if(!(PINB & (1<<PB0))) {
-        // Low state on PB0
-        if(calibrationFlag == 1 &&  mode == 2 && !(PIND & (1<<PD6))) ccMin -= 0.5f;
-        else if(calibrationFlag == 1 && mode == 3 && !(PIND & (1<<PD6))) distPulseCount -= 500;
-        else if(calibrationFlag == 0 && mode == 1 && !(PIND & (1<<PD6))) {
-            fuelLeft -= 0.5f;
-            savedFuel = fuelLeft;
-            eeprom_update_float(&eeSavedData.eeSavedFuel, savedFuel);
-        } else mode = (mode > 3) ? 1 : ++mode;
-    } 
+static void formatFuelUnit(char *text) {
+    if(tripNow.speed > 5) strcpy(text, "L/100");     // Car is moving
+    else strcpy(text, "L/H");                // Car is not moving
 }
 
-ISR(PCINT2_vect) {
-    if(!(PIND & (1<<PD7))) {
-        // Low state on PD7
-        if(calibrationFlag == 1 && mode == 2 && !(PIND & (1<<PD6))) ccMin += 0.5f;
-        else if(calibrationFlag == 1 && mode == 3 && !(PIND & (1<<PD6))) distPulseCount += 500;
-        else if(calibrationFlag == 0 && mode == 1 && !(PIND & (1<<PD6))) {
-            fuelLeft += 0.5f;
-            savedFuel = fuelLeft;
-            eeprom_update_float(&eeSavedData.eeSavedFuel, savedFuel);
-        } else mode = (mode < 2) ? 3 : --mode;
-    } 
+static void formatAvgFuel(char *text) {
+    if(tripNow.avgFuel < 5) strcpy(text, "--.-");
+    else fixtoa(tripNow.avgFuel, 2, 1, 0, text);
 }
 
 
-#if USE_DHT == 1
-void tempRead() {
-    int data[5] = {0, 0, 0, 0, 0};
-    uint16_t last = 1, j = 0;
-
-    DHT_EN_INP;
-    for(int i = 0; i < MAX_TIMING; i++) {
-        uint16_t count = 0;
-        while((PIND & DHT_PIN) == last) {
-            count++;
-            _delay_us(1);
-            if(count == 255) break;
-        }
+// Fuel infoscreen
+static const field FUEL_FIELDS[] PROGMEM = {
+    {25,  1, 40,  7, 1, EVENT_SECOND, formatUsedFuel},
+    { 1, 17, 69, 14, 2, EVENT_TICK,   formatTraveledDistance},
+    {35, 40, 35,  7, 1, EVENT_SECOND, formatFuelLeft}
+};
+
+// Speed infoscreen
+static const field SPEED_FIELDS[] PROGMEM = {
+    { 6,  7, 50, 14, 2, EVENT_SPEED,  formatSpeed},
+    {23, 40, 33,  7, 1, EVENT_SECOND, formatAvgSpeed}
+};
+
+// Main screen
+static const field MAIN_FIELDS[] PROGMEM = {
+    {25,  1, 40,  7, 1, EVENT_SECOND, formatRange},
+    { 1, 17, 53, 14, 2, EVENT_SECOND, formatInstantFuel},
+    {54, 22, 30,  7, 1, EVENT_TICK,   formatFuelUnit},
+    {23, 40, 31,  7, 1, EVENT_SECOND, formatAvgFuel}
+};
+
+// Acceleration infoscreen
+static const field ACCELERATION_FIELDS[] PROGMEM = {
+    { 6,  7, 50, 14, 2, EVENT_SPEED,  formatSpeed},
+    {23, 40, 33,  7, 1, EVENT_TICK,   formatAccTime}
+};
+
+// Traveled distance without burning fuel
+static const field SAILING_FIELDS[] PROGMEM = {
+    {25,  1, 40,  7, 1, EVENT_SECOND, formatUsedFuel},
+    { 1, 17, 54, 14, 2, EVENT_TICK,   formatSailingDistance},
+    {35, 40, 35,  7, 1, EVENT_SECOND, formatFuelLeft}
+};
+
+static const screen SCREENS[] PROGMEM = {
+    {SCREEN_FUEL,         FUEL_FIELDS,         3},  // 1
+    {SCREEN_SPEED,        SPEED_FIELDS,        2},  // 2
+    {SCREEN_MAIN,         MAIN_FIELDS,         4},  // 3
+    {SCREEN_ACCELERATION, ACCELERATION_FIELDS, 2},  // 4
+    {SCREEN_SAILING,      SAILING_FIELDS,      3}   // 5
+};
+
+
+// Text screens are drawn from scratch every frame, in the 48 rows of the LCD layout
+static void markText(void) {displayMark(0, 0, DISPLAY_WIDTH, 48);}
+
+void drawScreen(uint8_t mode, uint8_t events) {
+    register uint8_t i;
+    char text[FIELD_TEXT];
+    screen s;
+    field f;
+
+    #if USE_PROBE == 1
+    if(mode == PROBE_MODE) {drawProbe(); return;}
+    #endif
 
-        last = (PIND & DHT_PIN);
-        if(count == 255) break;
+    if(mode < 1 || mode > 5) {
+        char buffer[8];
 
-        if((i >= 4) && (i % 2 == 0)) {
-            data[j/8] <<= 1;
-            if(count > 16) data[j/8] |= 1;
-            j++;
-        }
+        shownScreen = 0;
+        displayClear();
+        markText();
+        displayCursor(1, 1); displayText("L//M - ", 1); 
+        displayText(itoa(mode, buffer, 10), 1);
+        return;
+    }
+
+    memcpy_P(&s, &SCREENS[mode-1], sizeof(screen));
+    if(shownScreen != mode) {
+        // Static labels are copied in once, fields are redrawn from scratch
+        displayMark(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        for(i = 0; i != s.count; ++i) fieldText[i][0] = FIELD_STALE;
+    }
+    if(!DISPLAY_PARTIAL || shownScreen != mode) {
+        displayBackground(s.background);
+        shownScreen = mode;
+    }
 
-        if((j >= 40) && (data[4] == ((data[0] + data[1] + data[2] + data[3]) & 0xFF))) {
-            dht.humidity = (float)((data[0]<<8) + data[1]) / 10;
-            if(dht.humidity > 100) dht.humidity = data[0];
+    for(i = 0; i != s.count; ++i) {
+        memcpy_P(&f, &s.fields[i], sizeof(field));
+        if(DISPLAY_PARTIAL && !(events & (f.events | EVENT_NAV)) && fieldText[i][0] != FIELD_STALE) continue;
+        f.format(text);
 
-            dht.temperature = (float)(((data[2] & 0x7F)<<8) + data[3]) / 10;
-            if(dht.temperature > 125) dht.temperature = data[2];
-            if(data[2] & 0x80) dht.temperature = -dht.temperature;
-        }
+        // Nothing to do if the field shows the same text - strip based displays still draw it into every strip,
+        // but only send it when it has changed
+        if(strcmp(text, fieldText[i])) {
+            strcpy(fieldText[i], text);
+            displayMark(f.x, f.y, f.width, f.height);
+        } else if(DISPLAY_PARTIAL) continue;
+
+        displayRestore(s.background, f.x, f.y, f.width, f.height);
+        displayCursor(f.x, f.y); displayText(text, f.scale);
     }
 }
-#endif
-
 
-void avgSpeed() {
-    // Harmonic mean
-    // Thanks to Gabryś "Dragroth" Król we've got now really good solution for average speed and fuel calculations.
-    // His disappointment, when he saw my miserable arithmetic mean, was immeasurable and his day was ruined.
-    // He took matters into his own hands and after few tests he came up with the solution you can see in here.
-    sumInv += 1.0f/speed;
-    avgSpeedCount = avgSpeedDivider/sumInv;
+void drawCalibration(uint8_t mode) {
+    char buffer[8], res[16];  // 8 decimals of the calibration values
+
+    shownScreen = 0;  // Static layer has to be loaded again after calibration
+    displayClear();
+    markText();
+
+    switch(mode) {
+        case 1: 
+            // Values queued by `saveCalibration()` - EEPROM gets them in the background
+            displayText("L//K", 1);
+            displayCursor(0, 9);
+            ftoa(settings.eePulseDistance, res, 8);
+            displayText(res, 1);
+
+            displayCursor(0, 18);
+            ftoa(settings.eeInjectionValue, res, 8);
+            displayText(res, 1);
+        break;
+
+        case 2:
+            ftoa(ccMin, res, 1);
+            displayCursor(0, 1); displayText("50: ", 1);
+            displayText(res, 1);
+            
+            ftoa(divideFuelFactor, res, 1);
+            displayCursor(0, 9); displayText("55: ", 1);
+            displayText(res, 1);
+        break;
+
+        case 3: 
+            displayCursor(0, 1); displayText("40: ", 1);
+            displayText(ltoa(distPulseCount, buffer, 10), 1);
+            
+            displayCursor(0, 9); displayText("41: ", 1);
+            displayText(itoa(pulseOverflows, buffer, 10), 1);
+        break;
+    }
 }
-void currentSpeed() {speed = PULSE_DISTANCE * distPulseCount * 3600;}
 
+#if USE_PROBE == 1
+static uint16_t probeMicros(uint32_t ticks) {return ticks * TICK_CYCLES / TICK_MHZ;}
+static uint16_t probeMillis(uint32_t ticks) {return ticks * TICK_CYCLES / CYCLES_PER_MS;}
 
-void fuelConsumption() {
-    const unsigned inj = 4;
-    int it = 3600 * inj;
-    float iotv = (injectorOpenTime*INJECTION_VALUE)*it;     // A6 C4 2.6 V6 - 21600 because 3600 (seconds in hour) * 6 (no. of injectors)
-    float inv  = (injectorOpenTime*INJECTION_VALUE)*inj;
+// One line per section - average/worst time in us, then missed edges
+static void drawProbeLine(uint8_t y, const char *label, const probeStat *s) {
+    char buffer[8], text[16];
 
-    injectorOpenTime = ((float)injectorPulseTime/1000);     // Converting to seconds
-    if(speed > 5) {
-        instantFuelConsumption = (100*iotv)/speed;
+    strcpy(text, label);
+    ltoa(s->count ? probeMicros(s->total / s->count) : 0, buffer, 10); strcat(text, buffer);
+    strcat(text, "/");
+    ltoa(s->count ? probeMicros(s->max) : 0, buffer, 10); strcat(text, buffer);
+    strcat(text, " ");
+    itoa(s->misses, buffer, 10); strcat(text, buffer);
 
-        // Harmonic mean 
-        if(instantFuelConsumption > 0 && instantFuelConsumption < 100) {
-            fuelSumInv += 1.0f/instantFuelConsumption;
-            averageFuelConsumption = avgSpeedDivider/fuelSumInv;
-        }
-    } else instantFuelConsumption = iotv;
+    displayCursor(0, y); displayText(text, 1);
+}
+
+void drawProbe(void) {
+    char buffer[8], text[16];
+    probeStats p;
+
+    // ISRs keep counting - take a consistent copy
+    cli();
+    p = probe;
+    sei();
 
-    usedFuel += inv;
-    fuelLeft -= inv;
+    shownScreen = 0;
+    displayClear();
+    markText();
+
+    strcpy(text, "FPS ");
+    itoa(p.fps, buffer, 10); strcat(text, buffer);
+    strcat(text, " CLI ");
+    ltoa(p.stats[PROBE_CLI].count ? probeMicros(p.stats[PROBE_CLI].max) : 0, buffer, 10); strcat(text, buffer);
+    displayCursor(0, 0); displayText(text, 1);
+
+    // Frame in ms - it can take longer than the 16 bit microseconds
+    strcpy(text, "FR ");
+    ltoa(p.stats[PROBE_FRAME].count ? probeMillis(p.stats[PROBE_FRAME].total / p.stats[PROBE_FRAME].count) : 0, buffer, 10); strcat(text, buffer);
+    strcat(text, "/");
+    ltoa(probeMillis(p.stats[PROBE_FRAME].max), buffer, 10); strcat(text, buffer);
+    strcat(text, " ");
+    itoa(p.stats[PROBE_FRAME].misses, buffer, 10); strcat(text, buffer);
+    displayCursor(0, 8); displayText(text, 1);
+
+    drawProbeLine(16, "VS ", &p.stats[PROBE_INT0]);
+    drawProbeLine(24, "IN ", &p.stats[PROBE_INT1]);
+    drawProbeLine(32, "T1 ", &p.stats[PROBE_TIMER1]);
+    drawProbeLine(40, "PC ", &p.stats[PROBE_PCINT2]);
 }
+#endif
 
+// Strip based displays call this once per strip, so it must only draw
+void drawFrame(void) {
+    if(!calibrationFlag) drawScreen(mode, drawEvents);
+    else drawCalibration(mode);
+}
 
-#if USE_INTERNAL_EEPROM == 1
-void saveData() {
+void saveCalibration(void) {
+    // Only the pulse counters are shared with ISRs - EEPROM is written from the main loop alone
     cli();
+    float ff = 65536.0f*pulseOverflows;
+          ff += distPulseCount;
+    sei();
 
-    eeprom_update_word(&eeSavedData.eeSaveFlag, SAVE_FLAG);
+    // Simple formula - distance/pulses
+          ff = 10/ff; 
 
-    eeprom_update_float(&eeSavedData.eeTraveledDistance, traveledDistance);
+    float inv = ccMin/1000;
+          inv = inv/60;
+    eeStruct next = settings;
 
-    eeprom_update_float(&eeSavedData.eeAverageFuelConsumption, averageFuelConsumption);
-    eeprom_update_float(&eeSavedData.eeUsedFuel, usedFuel);
-    eeprom_update_float(&eeSavedData.eeSavedFuel, savedFuel);
+    // No pulses counted (or taken away with BACK) - nothing to calibrate with, the saved values stay
+    if(!(ff > 0) || isinf(ff) || !(inv > 0)) return;
 
-    eeprom_update_byte(&eeSavedData.eeAverageSpeedCount, avgSpeedCount);
-    eeprom_update_float(&eeSavedData.eeAvgSpeedDivider, avgSpeedDivider);
-    
-    eeprom_update_float(&eeSavedData.eeSumInv, sumInv);
-    eeprom_update_float(&eeSavedData.eeFuelSumInv, fuelSumInv);
+    // Called every frame of the calibration screen - EEPROM is only written when the values change
+    if(settings.eeSaveFlag == SAVE_FLAG && ff == settings.eePulseDistance && inv == settings.eeInjectionValue) return;
 
-    saveCounter = 60;
-    sei();
+    // Calibration data is stored in EEPROM - a full queue leaves it for the next frame
+    next.eePulseDistance = ff;
+    next.eeInjectionValue = inv;
+    next.eeSaveFlag = SAVE_FLAG;
+    if(!persistWrite(&eeSavedData.eePulseDistance, &next.eePulseDistance, CALIBRATION_BYTES)) return;
+    settings = next;
+
+    // Used from now on, not only after the next power up
+    tripCalibrate(settings.eePulseDistance, settings.eeInjectionValue, INJECTORS);
+    speedCalibrate(settings.eePulseDistance);
 }
 
-void loadData() {
-    cli();
 
-    PULSE_DISTANCE  = eeprom_read_float(&eeSavedData.eePulseDistance);
-    INJECTION_VALUE = eeprom_read_float(&eeSavedData.eeInjectionValue);
+#if USE_INTERNAL_EEPROM == 1
+uint8_t saveData() {
+    storeRecord record;
+
+    record.trip = trip;
+    record.savedFuel = savedFuel;
+
+    // 0 - EEPROM queue is full
+    return storeSave(&record);
+}
 
-    traveledDistance = isnan(eeprom_read_float(&eeSavedData.eeTraveledDistance)) ? 0 : eeprom_read_float(&eeSavedData.eeTraveledDistance);
+// Calibration and trip of the first firmware, in today's units. Its average speed can't be carried over
+static uint8_t loadLegacy(eeStruct *settings, storeRecord *record) {
+    eeLegacy old;
+    float ticksPerLitre;
+
+    eeprom_read_block(&old, &eeSavedData, sizeof(eeLegacy));
+    if(old.saveFlag != SAVE_FLAG || !(old.pulseDistance > 0) || !(old.injectionValue > 0)) return 0;
+
+    settings->eeDivideFuelFactor = (old.divideFuelFactor > 0) ? old.divideFuelFactor : 0;
+    settings->eePulseDistance = old.pulseDistance;
+    settings->eeInjectionValue = old.injectionValue;
+    settings->eeSaveFlag = SAVE_FLAG;
+
+    // Negated comparisons also catch NaN
+    if(!(old.distance > 0)) old.distance = 0;
+    if(!(old.usedFuel > 0)) old.usedFuel = 0;
+    if(!(old.avgFuel > 0)) old.avgFuel = 0;
+    if(!(old.savedFuel > 0)) old.savedFuel = 0;
+    ticksPerLitre = (F_CPU / TRIP_TICK_CYCLES) / (old.injectionValue * INJECTORS);
+
+    memset(record, 0, sizeof(storeRecord));
+    record->trip.pulses = old.distance / old.pulseDistance + 0.5f;
+    record->trip.fuelTicks = old.usedFuel * ticksPerLitre + 0.5f;
+
+    // Average consumption was kept as a value - it's carried over as that much fuel over the whole distance
+    record->trip.avgPulses = record->trip.pulses;
+    record->trip.avgFuelTicks = old.avgFuel / 100 * old.distance * ticksPerLitre + 0.5f;
+    record->savedFuel = old.savedFuel * 1000 + 0.5f;
+    return 1;
+}
 
-    averageFuelConsumption = isnan(eeprom_read_float(&eeSavedData.eeAverageFuelConsumption)) ? 0 : eeprom_read_float(&eeSavedData.eeAverageFuelConsumption);
-    usedFuel  = isnan(eeprom_read_float(&eeSavedData.eeUsedFuel))  ? 0 : eeprom_read_float(&eeSavedData.eeUsedFuel);
-    savedFuel = isnan(eeprom_read_float(&eeSavedData.eeSavedFuel)) ? 0 : eeprom_read_float(&eeSavedData.eeSavedFuel);
-    divideFuelFactor = isnan(eeprom_read_float(&eeSavedData.eeDivideFuelFactor)) ? 0 : eeprom_read_float(&eeSavedData.eeDivideFuelFactor);
+void loadData() {
+    storeRecord record;
+    uint8_t loaded = storeLoad(&record);
+
+    // Older layouts are converted once. The record goes first, into a slot clear of the struct
+    // of the first firmware - power lost before the settings are written just converts it again
+    eeprom_read_block(&settings, &eeSavedData, sizeof(eeStruct));
+    switch(settings.eeFormat) {
+        case EEPROM_FORMAT: break;
+
+        default:
+            memset(&settings, 0xFF, sizeof(eeStruct));
+            loaded = loadLegacy(&settings, &record);
+            if(loaded) storeSave(&record);
+
+            // Anything else can't be trusted - calibration has to be done again
+            settings.eeFormat = EEPROM_FORMAT;
+            persistWrite(&eeSavedData, &settings, sizeof(eeStruct));
+        break;
+    }
 
-    avgSpeedCount = isnan(eeprom_read_byte(&eeSavedData.eeAverageSpeedCount)) ? 0 
-                        : (eeprom_read_byte(&eeSavedData.eeAverageSpeedCount) >= 255 ? 0 
-                            : eeprom_read_byte(&eeSavedData.eeAverageSpeedCount));
-    avgSpeedDivider = isnan(eeprom_read_float(&eeSavedData.eeAvgSpeedDivider)) ? 0 : eeprom_read_float(&eeSavedData.eeAvgSpeedDivider);
+    // Calibration is only trusted when it has been saved by `saveCalibration()`
+    if(settings.eeSaveFlag == SAVE_FLAG) {
+        tripCalibrate(settings.eePulseDistance, settings.eeInjectionValue, INJECTORS);
+        speedCalibrate(settings.eePulseDistance);
+        divideFuelFactor = isnan(settings.eeDivideFuelFactor) ? 0 : settings.eeDivideFuelFactor;
+    }
 
-    sumInv = isnan(eeprom_read_float(&eeSavedData.eeSumInv)) ? 0 : eeprom_read_float(&eeSavedData.eeSumInv);
-    fuelSumInv = isnan(eeprom_read_float(&eeSavedData.eeFuelSumInv)) ? 0 : eeprom_read_float(&eeSavedData.eeFuelSumInv);
+    if(loaded) {
+        trip = record.trip;
+        savedFuel = record.savedFuel;
+    } else {
+        memset(&trip, 0, sizeof(tripCounters));
+        savedFuel = 0;
+    } tripAverages();
 
     _delay_ms(25);
-    sei();
 }
 #else 
-void saveData() {return;}
+uint8_t saveData() {return 1;}
 void loadData() {return;}
 #endif
\ No newline at end of file
@@ -25,7 +25,9 @@
 
 volatile unsigned long int timer0_overflowCount = 0;
 volatile unsigned long int timer0_millis = 0;
-static unsigned char timer0_fract = 0;
+static uint16_t timer0_fract = 0;             // Cycles counted towards the next millisecond
+volatile uint32_t timer0_micros = 0;          // At the last overflow
+static uint8_t timer0_microsFract = 0;        // Cycles counted towards the next microsecond
 unsigned long int starttime = 0, endtime = 0;
 
 unsigned long int millis() {
@@ -36,23 +38,76 @@ unsigned long int millis() {
     // Inconsistent value (e.g. in the middle of a write to timer0_millis)
     cli();
     m = timer0_millis;
-    SREG = oldSREG;
-    sei();
+    SREG = oldSREG;  // Interrupts stay disabled if the caller had them disabled
     return m;
 }
 
+// Microseconds since start, wraps after ~71 minutes. Counted on its own rather than worked out from
+// `ticks()` - 2^32 ticks aren't a whole number of 2^32 us at 20 MHz, so that would jump where the ticks wrap
+uint32_t micros() {
+    uint32_t m;
+    uint8_t f, t, oldSREG = SREG;
+
+    cli();
+    m = timer0_micros;
+    f = timer0_microsFract;
+    t = TCNT0;
+
+    // Overflow that happened after we got here hasn't been counted yet
+    if((TIFR0 & (1<<TOV0)) && t < 255) {
+        m += MICROS_INC;
+        f += MICROS_FRACT_INC;
+    }
+    SREG = oldSREG;
+
+    return m + (f + (uint16_t)t * TICK_CYCLES) / TICK_MHZ;
+}
+
+// Safe to call anywhere - profiling timestamps
+uint32_t ticks_now() {
+    uint32_t t;
+    uint8_t oldSREG = SREG;
+
+    cli();
+    t = ticks();
+    SREG = oldSREG;
+    return t;
+}
+
+// TIMER0 ticks (TICK_CYCLES clock cycles) since start, wraps after ~4.8 hours at 16 MHz
+// Cheap enough for ISRs - must be called with interrupts disabled
+uint32_t ticks() {
+    uint32_t o = timer0_overflowCount;
+    uint8_t t = TCNT0;
+
+    // Overflow that happened after we got here hasn't been counted yet
+    if((TIFR0 & (1<<TOV0)) && t < 255) ++o;
+    return (o << 8) | t;
+}
+
 ISR(TIMER0_OVF_vect) {
     unsigned long int m = timer0_millis;
-    unsigned char f = timer0_fract;
+    uint16_t f = timer0_fract;
+    uint32_t u = timer0_micros;
+    uint8_t uf = timer0_microsFract;
 
     m += MILLIS_INC;
     f += FRACT_INC;
-    if(f >= FRACT_MAX) {
-        f -= FRACT_MAX;
+    if(f >= CYCLES_PER_MS) {
+        f -= CYCLES_PER_MS;
         m += 1;
     }
 
+    u += MICROS_INC;
+    uf += MICROS_FRACT_INC;
+    if(uf >= TICK_MHZ) {
+        uf -= TICK_MHZ;
+        u += 1;
+    }
+
     timer0_fract = f;
     timer0_millis = m;
+    timer0_micros = u;
+    timer0_microsFract = uf;
     timer0_overflowCount++;
 }
\ No newline at end of file
@@ -18,10 +18,37 @@
 // <https://itcrowd.net.pl/>
 
 
-#define clockCyclesToMicroseconds(a) (((a) * 1000L)/(F_CPU / 1000L))
-#define MICROSECONDS_PER_TIMER0_OVERFLOW (clockCyclesToMicroseconds(64 * 256))
-#define MILLIS_INC (MICROSECONDS_PER_TIMER0_OVERFLOW / 1000)
-#define FRACT_INC ((MICROSECONDS_PER_TIMER0_OVERFLOW % 1000)>>3)
-#define FRACT_MAX (1000>>3)
+#ifndef MILLIS_H
+#define MILLIS_H
 
-unsigned long int millis();
\ No newline at end of file
+#include <stdint.h>
+
+// TIMER0 runs with prescaler 64 - one tick is 4us at 16 MHz (crystal) and 8us at 8 MHz (internal RC)
+#define TICK_CYCLES  64
+
+// One overflow is 1.024 ms at 16 MHz but 0.8192 ms at 20 MHz - whole ms and us per overflow, and the cycles
+// left over, which the overflow ISR adds up so that neither count drifts at any F_CPU
+#define OVERFLOW_CYCLES (TICK_CYCLES * 256L)
+#define CYCLES_PER_MS   (F_CPU / 1000L)
+#define MILLIS_INC (OVERFLOW_CYCLES / CYCLES_PER_MS)
+#define FRACT_INC  (OVERFLOW_CYCLES % CYCLES_PER_MS)
+#define MICROS_INC (OVERFLOW_CYCLES / TICK_MHZ)
+#define MICROS_FRACT_INC (OVERFLOW_CYCLES % TICK_MHZ)
+
+#define TICK_MHZ     (F_CPU / 1000000L)
+#define TICKS_PER_S  (F_CPU / TICK_CYCLES)   // Whole at any whole MHz - 1000000 is a multiple of 64
+#define MS_TO_TICKS(ms) ((ms) * CYCLES_PER_MS / TICK_CYCLES)   // From cycles, a ms is 312.5 ticks at 20 MHz
+#define US_TO_TICKS(us) ((us) * TICK_MHZ / TICK_CYCLES)   // Rounded down, 3.2us ticks at 20 MHz
+
+#if F_CPU % 1000000L
+    #error "F_CPU has to be a whole number of MHz"
+#endif
+
+unsigned long int millis();
+// 32 bits on purpose - `unsigned long` of the AVR, the host build has to wrap where the chip does
+uint32_t micros();
+// 32 bits on purpose - `unsigned long` of the AVR, the host build has to wrap where the chip does
+uint32_t ticks();
+uint32_t ticks_now();
+
+#endif  // MILLIS_H
@@ -0,0 +1,65 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#include "display.h"
+
+#if USE_DISPLAY_MOCK == 1
+
+#include <avr/pgmspace.h>
+#include <string.h>
+
+
+uint8_t  mockScreen[MOCK_WIDTH*MOCK_HEIGHT/8];
+uint16_t mockFrames = 0;
+
+
+void mockClear(void) {memset(mockScreen, 0x00, sizeof(mockScreen));}
+
+void mockColumn(uint8_t x, uint8_t y, uint32_t bits, uint8_t height) {
+    register uint8_t bank = y >> 3;
+    uint32_t mask = ((1UL<<height) - 1) << (y & 7);
+
+    if(x >= MOCK_WIDTH) return;
+
+    bits <<= (y & 7);
+    for(; mask && bank != MOCK_HEIGHT/8; ++bank, mask >>= 8, bits >>= 8) {
+        uint8_t *byte = &mockScreen[bank*MOCK_WIDTH+x];
+        *byte = (*byte & ~(uint8_t)mask) | ((uint8_t)bits & (uint8_t)mask);
+    }
+}
+
+void mockBackground(const uint8_t *bitmap) {memcpy_P(mockScreen, bitmap, sizeof(mockScreen));}
+
+void mockRestore(const uint8_t *bitmap, uint8_t x, uint8_t y, uint8_t width, uint8_t height) {
+    register uint8_t bank, i;
+    uint8_t last = (y+height-1) >> 3;
+    uint8_t end = (x+width > MOCK_WIDTH) ? MOCK_WIDTH : x+width;
+
+    if(last >= MOCK_HEIGHT/8) last = MOCK_HEIGHT/8 - 1;
+    for(bank = y >> 3; bank <= last; ++bank)
+        for(i = x; i != end; ++i) mockScreen[bank*MOCK_WIDTH+i] = pgm_read_byte(&bitmap[bank*MOCK_WIDTH+i]);
+}
+
+uint8_t mockSwap(void) {
+    ++mockFrames;
+    return 1;
+}
+
+#endif  // USE_DISPLAY_MOCK
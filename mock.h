@@ -0,0 +1,39 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#ifndef MOCK_H
+#define MOCK_H
+
+#include <stdint.h>
+
+// In-memory display with PCD8544 geometry - lets screens be drawn and inspected on a host
+#define MOCK_WIDTH  84
+#define MOCK_HEIGHT 48
+
+extern uint8_t  mockScreen[MOCK_WIDTH*MOCK_HEIGHT/8];  // Same layout as PCD8544 RAM - 6 banks of 84 columns
+extern uint16_t mockFrames;                            // Frames handed over with mockSwap()
+
+void mockClear(void);
+void mockColumn(uint8_t x, uint8_t y, uint32_t bits, uint8_t height);
+void mockBackground(const uint8_t *bitmap);
+void mockRestore(const uint8_t *bitmap, uint8_t x, uint8_t y, uint8_t width, uint8_t height);
+uint8_t mockSwap(void);
+
+#endif  // MOCK_H
@@ -1,3 +1,27 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#include "display.h"
+
+#if USE_SSD1327 == 1
+
 #include <avr/io.h>
 #include <avr/pgmspace.h>
 #include <util/delay.h>
@@ -5,13 +29,24 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "oled.h"
+#include "chars.h"
 
 
+// One strip of the frame - 128 columns * 16 rows * 4 bits
+// Full 128x128 frame would take 8 KB, so the scene is drawn strip by strip into this buffer
 byte ssd1327_buf[1024] = {
 
 };  
 
+static byte stripTop = 0;  // First row of the scene held in `ssd1327_buf`
+
+// Blocks of every strip marked by `oledMark()` - a bit for each, only those are sent by the next render
+static byte dirtyBlocks[SSD1327_HEIGTH/OLED_STRIP_ROWS];
+static byte fullRefresh = 1;
+
+static byte burstDC = 0xFF;  // D/C state within the current burst, 0xFF - no burst
+static word sent = 0;        // Bytes sent during last frame
+
 
 static void initSPI() {
     MOSI_DDR |= MOSI;
@@ -42,6 +77,35 @@ static void writeSPI(byte data) {
 }
 
 
+// Burst keeps CS asserted, D/C only changes between commands and data
+void oledBurstBegin(void) {
+    #if USE_CS == 1
+        CS_LO;
+    #endif
+    burstDC = 0xFF;
+}
+
+void oledBurstCMD(byte cmd) {
+    if(burstDC != 0) {
+        DC_LO;
+        burstDC = 0;
+    } writeSPI(cmd);
+}
+
+void oledBurstData(byte data) {
+    if(burstDC != 1) {
+        DC_HI;
+        burstDC = 1;
+    } writeSPI(data);
+}
+
+void oledBurstEnd(void) {
+    #if USE_CS == 1
+        CS_HI;
+    #endif
+}
+
+
 void sendCMD(byte cmd) {
     #if USE_CS == 1 
         CS_HI;
@@ -92,5 +156,165 @@ void oledInit(byte vcc, byte refresh) {
         CS_HI;
     #endif
     
-    
-}
\ No newline at end of file
+    oledBurstBegin();
+    oledBurstCMD(SSD1327_CMDLOCK);        // Unlock commands
+    oledBurstCMD(0x12);
+    oledBurstCMD(SSD1327_DISPLAYOFF);
+
+    oledBurstCMD(SSD1327_SETCOLUMN);      // Whole GDDRAM, 2 pixels per column
+    oledBurstCMD(0x00);
+    oledBurstCMD(SSD1327_WIDTH/2 - 1);
+    oledBurstCMD(SSD1327_SETROW);
+    oledBurstCMD(0x00);
+    oledBurstCMD(SSD1327_HEIGTH - 1);
+
+    oledBurstCMD(SSD1327_SETCONTRAST);
+    oledBurstCMD(0x80);
+    oledBurstCMD(SSD1327_SEGREMAP);       // Horizontal address increment, COM split, nibble remap
+    oledBurstCMD(0x51);
+    oledBurstCMD(SSD1327_SETSTARTLINE);
+    oledBurstCMD(0x00);
+    oledBurstCMD(SSD1327_SETDISPLAYOFFSET);
+    oledBurstCMD(0x00);
+    oledBurstCMD(SSD1327_SETMULTIPLEX);   // 128 MUX
+    oledBurstCMD(SSD1327_HEIGTH - 1);
+
+    oledBurstCMD(SSD1327_PHASELEN);
+    oledBurstCMD(0xF1);
+    oledBurstCMD(SSD1327_DCLK);           // Oscillator frequency in the high nibble sets refresh rate
+    oledBurstCMD(refresh);
+    oledBurstCMD(SSD1327_REGULATOR);      // Internal VDD regulator unless supply is external
+    oledBurstCMD(vcc == SSD1327_EXTERNALVCC ? 0x00 : 0x01);
+    oledBurstCMD(SSD1327_PRECHARGE2);
+    oledBurstCMD(0x0F);
+    oledBurstCMD(SSD1327_SETVCOM);
+    oledBurstCMD(0x0F);
+    oledBurstCMD(SSD1327_PRECHARGE);
+    oledBurstCMD(0x08);
+    oledBurstCMD(SSD1327_FUNCSELB);       // Second precharge and internal VSL
+    oledBurstCMD(0x62);
+
+    oledBurstCMD(SSD1327_NORMALDISPLAY);
+    oledBurstCMD(SSD1327_DISPLAYON);
+    oledBurstEnd();
+
+    fullRefresh = 1;
+}
+
+
+void oledClear(byte gray) {
+    memset(ssd1327_buf, (gray & 0x0F) | (gray << 4), sizeof(ssd1327_buf));
+}
+
+void oledSetPixel(byte x, byte y, byte gray) {
+    byte *pixels;
+
+    // Pixels outside of the strip are drawn when its turn comes
+    if(x >= SSD1327_WIDTH || y < stripTop || y >= stripTop + OLED_STRIP_ROWS) return;
+
+    pixels = &ssd1327_buf[(y - stripTop)*(SSD1327_WIDTH/2) + x/2];
+    if(x & 1) *pixels = (*pixels & 0xF0) | (gray & 0x0F);
+    else *pixels = (*pixels & 0x0F) | (gray << 4);
+}
+
+void oledWriteChar(byte x, byte y, char code, byte scale, byte gray) {
+    byte column, row, first, last;
+
+    // Only rows of the glyph inside the current strip
+    if(y >= stripTop + OLED_STRIP_ROWS || y + 7*scale <= stripTop) return;
+    first = (y < stripTop) ? stripTop - y : 0;
+    last  = (y + 7*scale > stripTop + OLED_STRIP_ROWS) ? stripTop + OLED_STRIP_ROWS - y : 7*scale;
+
+    for(column = 0; column != 5*scale; ++column) {
+        byte bits = pgm_read_byte(&CHARSET[code-32][column/scale]);
+
+        for(row = first; row != last; ++row)
+            oledSetPixel(x + column, y + row, (bits & (1 << row/scale)) ? gray : SSD1327_BLACK);
+    }
+}
+
+void oledColumn(byte x, byte y, dword bits, byte height, byte gray) {
+    byte row;
+
+    for(row = 0; row != height; ++row, bits >>= 1)
+        oledSetPixel(x, y + row, (bits & 1) ? gray : SSD1327_BLACK);
+}
+
+// 1 bit PROGMEM layer in PCD8544 layout (banks of 8 rows, 84 columns wide)
+void oledBitmap(const byte *bitmap, byte x, byte y, byte width, byte height, byte gray) {
+    byte column, row;
+
+    for(row = y; row != y + height; ++row) {
+        if(row < stripTop || row >= stripTop + OLED_STRIP_ROWS) continue;
+
+        for(column = x; column != x + width; ++column)
+            oledSetPixel(column, row, (pgm_read_byte(&bitmap[(row >> 3)*84 + column]) & (1 << (row & 7))) ? gray : SSD1327_BLACK);
+    }
+}
+
+void oledWriteString(byte x, byte y, const char *str, byte scale, byte gray) {
+    while(*str) {
+        oledWriteChar(x, y, *str++, scale, gray);
+        x += 5*scale + 1;
+    }
+}
+
+void oledMark(byte x, byte y, byte width, byte height) {
+    byte block, strip, last, mask = 0;
+
+    if(!width || !height || x >= SSD1327_WIDTH || y >= SSD1327_HEIGTH) return;
+    if(x + width > SSD1327_WIDTH) width = SSD1327_WIDTH - x;
+    if(y + height > SSD1327_HEIGTH) height = SSD1327_HEIGTH - y;
+
+    // Blocks the columns touch, 2 pixels to a column
+    for(block = x/2/OLED_BLOCK_COLUMNS, last = (x + width - 1)/2/OLED_BLOCK_COLUMNS; block <= last; ++block) mask |= 1 << block;
+    for(strip = y/OLED_STRIP_ROWS, last = (y + height - 1)/OLED_STRIP_ROWS; strip <= last; ++strip) dirtyBlocks[strip] |= mask;
+}
+
+void oledInvalidate(void) {fullRefresh = 1;}
+
+word oledSent(void) {return sent;}
+
+void oledRender(void (*draw)(void)) {
+    register byte block, row, column;
+    byte strip, first, last, dirty;
+    word count = 0;
+
+    oledBurstBegin();
+    for(strip = 0, stripTop = 0; stripTop < SSD1327_HEIGTH; ++strip, stripTop += OLED_STRIP_ROWS) {
+        // Marks come from `draw` too - the first strip marks what changes further down
+        oledClear(SSD1327_BLACK);
+        draw();
+
+        dirty = fullRefresh ? (1 << OLED_BLOCKS) - 1 : dirtyBlocks[strip];
+        dirtyBlocks[strip] = 0;
+        if(!dirty) continue;
+
+        // Window of the strip spans from the first to the last marked block
+        first = OLED_BLOCKS;
+        last = 0;
+        for(block = 0; block != OLED_BLOCKS; ++block) {
+            if(!(dirty & (1 << block))) continue;
+            if(block < first) first = block;
+            last = block;
+        }
+
+        oledBurstCMD(SSD1327_SETCOLUMN);
+        oledBurstCMD(first*OLED_BLOCK_COLUMNS);
+        oledBurstCMD((last+1)*OLED_BLOCK_COLUMNS - 1);
+        oledBurstCMD(SSD1327_SETROW);
+        oledBurstCMD(stripTop);
+        oledBurstCMD(stripTop + OLED_STRIP_ROWS - 1);
+
+        for(row = 0; row != OLED_STRIP_ROWS; ++row)
+            for(column = first*OLED_BLOCK_COLUMNS; column != (last+1)*OLED_BLOCK_COLUMNS; ++column)
+                oledBurstData(ssd1327_buf[row*(SSD1327_WIDTH/2) + column]);
+        count += (last - first + 1) * OLED_BLOCK_COLUMNS * OLED_STRIP_ROWS;
+    } oledBurstEnd();
+
+    stripTop = 0;
+    fullRefresh = 0;
+    sent = count;
+}
+
+#endif  // USE_SSD1327
@@ -1,6 +1,8 @@
 #ifndef OLED_H
 #define OLED_H
 
+#include <stdint.h>
+
 #include "commons.h"
 
 #define USE_CS  1
@@ -64,7 +66,7 @@
 
 // SSD1327
 #define SSD1327_BLACK 0x00
-#define SSD1327_WHITE 0xF0
+#define SSD1327_WHITE 0x0F  // 4 bit gray levels, 0x00 - 0x0F
 
 #define SSD1327_SETLOWCOLUMN                            0x00
 #define SSD1327_EXTERNALVCC                             0x01
@@ -78,7 +80,6 @@
 #define SSD1327_VERTICAL_AND_LEFT_HORIZONTAL_SCROLL     0x2A
 #define SSD1327_DEACTIVATE_SCROLL                       0x2E
 #define SSD1327_ACTIVATE_SCROLL                         0x2F
-#define SSD1327_SETSTARTLINE                            0x40
 #define SSD1327_SETROW                                  0x75
 #define SSD1327_SETCONTRAST                             0x81
 #define SSD1327_SETBRIGHTNESS                           0x82
@@ -104,7 +105,6 @@
 #define SSD1327_SETVCOM                                 0xBE
 #define SSD1327_COMSCANINC                              0xC0
 #define SSD1327_COMSCANDEC                              0xC8
-#define SSD1327_SETDISPLAYOFFSET                        0xD3
 #define SSD1327_FUNCSELB                                0xD5
 #define SSD1327_SETCOMPINS                              0xDA
 #define SSD1327_SETVCOMDETECT                           0xDB
@@ -112,8 +112,37 @@
 #define SSD1327_CMDLOCK                                 0xFD
 
 
+#define OLED_STRIP_ROWS (sizeof(ssd1327_buf) / (SSD1327_WIDTH/2))  // 16 rows of 128 4 bit pixels
+
+// Changes are sent in blocks of 32 pixels (16 GDDRAM columns) of a strip
+#define OLED_BLOCK_COLUMNS 16
+#define OLED_BLOCKS        ((SSD1327_WIDTH/2) / OLED_BLOCK_COLUMNS)
+
+extern byte ssd1327_buf[1024];
+
+
 void oledInit(byte vcc, byte refresh);
 void sendData(byte data);
 void sendCMD(byte cmd);
 
-#endif
\ No newline at end of file
+// Streaming transfer - CS stays asserted from begin to end
+void oledBurstBegin(void);
+void oledBurstCMD(byte cmd);
+void oledBurstData(byte data);
+void oledBurstEnd(void);
+
+// Drawing happens into the current strip only, anything outside of it is clipped
+void oledClear(byte gray);
+void oledSetPixel(byte x, byte y, byte gray);
+void oledWriteChar(byte x, byte y, char code, byte scale, byte gray);
+void oledWriteString(byte x, byte y, const char *str, byte scale, byte gray);
+void oledColumn(byte x, byte y, dword bits, byte height, byte gray);
+void oledBitmap(const byte *bitmap, byte x, byte y, byte width, byte height, byte gray);
+
+// Calls `draw` once for every strip of the frame and pushes the marked windows to the panel
+void oledRender(void (*draw)(void));
+void oledMark(byte x, byte y, byte width, byte height);  // Sent by the next render - drawn differently than last time
+void oledInvalidate(void);  // Next render sends the whole frame
+word oledSent(void);        // Bytes of GDDRAM data sent by the last render
+
+#endif
@@ -0,0 +1,100 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "persist.h"
+
+#define BUFFER_MASK (PERSIST_BUFFER - 1)
+#define JOBS_MASK   (PERSIST_JOBS - 1)
+
+typedef struct {
+    uint16_t addr;
+    uint8_t  len;
+} persistJob;
+
+static persistJob jobs[PERSIST_JOBS];
+static uint8_t staged[PERSIST_BUFFER];
+
+// Free running indexes - heads are moved by the main loop, tails by the ISR
+static volatile uint8_t jobHead = 0, jobTail = 0, 
+                        dataHead = 0, dataTail = 0, jobPos = 0;
+
+volatile uint16_t persistWrites = 0;
+volatile uint16_t persistDone = 0;
+
+
+// Copies `len` bytes to be written at `eeAddr`, returns 0 if there's no room - nothing is queued then
+uint8_t persistWrite(void *eeAddr, const void *src, uint8_t len) {
+    const uint8_t *s = src;
+    register uint8_t i;
+
+    if(!len) return 1;
+    if((uint8_t)(jobHead - jobTail) >= PERSIST_JOBS) return 0;
+    if((uint8_t)(dataHead - dataTail) + len > PERSIST_BUFFER) return 0;
+
+    for(i = 0; i != len; ++i) staged[(uint8_t)(dataHead + i) & BUFFER_MASK] = s[i];
+    dataHead += len;
+
+    jobs[jobHead & JOBS_MASK].addr = (uint16_t)eeAddr;
+    jobs[jobHead & JOBS_MASK].len  = len;
+    ++jobHead;                        // Record is visible to the ISR from now on
+
+    EECR |= (1<<EERIE);
+    return 1;
+}
+
+uint8_t persistBusy(void) {return jobHead != jobTail;}
+
+// Waits until everything is in EEPROM - `eeprom_read_*()` may be used safely afterwards
+void persistFlush(void) {while(jobHead != jobTail);}
+
+
+// EEPROM is ready for the next byte - one byte per interrupt keeps it short
+ISR(EE_READY_vect) {
+    persistJob *job;
+    uint8_t data;
+
+    if(jobHead == jobTail) {
+        EECR &= ~(1<<EERIE);
+        return;
+    }
+
+    job = &jobs[jobTail & JOBS_MASK];
+    data = staged[dataTail & BUFFER_MASK];
+    EEAR = job->addr + jobPos;
+
+    ++dataTail;
+    if(++jobPos == job->len) {
+        jobPos = 0;
+        ++jobTail;
+        ++persistDone;
+    }
+
+    // Same as `eeprom_update_byte()` - unchanged bytes don't wear the cell
+    EECR |= (1<<EERE);
+    if(EEDR == data) return;
+
+    EEDR = data;
+    EECR |= (1<<EEMPE);               // EEPE has to be set within 4 cycles
+    EECR |= (1<<EEPE);
+    ++persistWrites;
+}
@@ -0,0 +1,38 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include <stdint.h>
+
+// Write-behind EEPROM queue - records are copied to RAM and programmed byte by byte
+// from EE_READY interrupt, so nobody waits ~3.3 ms per byte with interrupts disabled
+#define PERSIST_BUFFER 128            // Staged bytes, power of two up to 128
+#define PERSIST_JOBS   8              // Staged records, power of two
+
+extern volatile uint16_t persistWrites;   // Bytes actually programmed - unchanged ones are skipped
+extern volatile uint16_t persistDone;     // Records completely written
+
+uint8_t persistWrite(void *eeAddr, const void *src, uint8_t len);
+uint8_t persistBusy(void);
+void persistFlush(void);
+
+#endif  // PERSIST_H
@@ -0,0 +1,53 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#include "probe.h"
+
+#if USE_PROBE == 1
+
+#include <avr/interrupt.h>
+#include <string.h>
+
+probeStats probe;
+
+
+void probeReset(void) {
+    register uint8_t i;
+
+    cli();
+    memset(&probe, 0, sizeof(probe));
+    for(i = 0; i != PROBES; ++i) probe.stats[i].min = 0xFFFF;
+    sei();
+}
+
+// Main loop only - `elapsed` in TIMER0 ticks, `late` ticks that had piled up before the frame
+void probeFrame(unsigned long int elapsed, uint8_t late) {
+    probeAdd(PROBE_FRAME, elapsed > 0xFFFF ? 0xFFFF : elapsed, 0);
+    probe.stats[PROBE_FRAME].misses += late;
+    ++probe.frames;
+}
+
+// Once a second, from the main loop
+void probeSecond(void) {
+    probe.fps = probe.frames;
+    probe.frames = 0;
+}
+
+#endif  // USE_PROBE
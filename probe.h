@@ -0,0 +1,80 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#ifndef PROBE_H
+#define PROBE_H
+
+#include <avr/io.h>
+#include <stdint.h>
+#include "millis.h"
+
+#ifndef USE_PROBE
+    #define USE_PROBE 0               // 1 - time ISRs and frames, shown on a hidden screen;  0 - compiled out
+#endif
+
+// Timed sections - ISR bodies (prologue excluded), the drawn frame and the main loop's interrupts-disabled window
+enum {PROBE_INT0, PROBE_INT1, PROBE_TIMER1, PROBE_PCINT0, PROBE_PCINT2, PROBE_FRAME, PROBE_CLI, PROBES};
+
+// Times in TIMER0 ticks (TICK_CYCLES). ISRs start at any phase of a tick, so `total/count` resolves below one tick
+typedef struct {
+    uint16_t min, max;
+    uint32_t total;
+    uint32_t count;
+    uint16_t misses;                  // ISRs: own flag set again on exit, one more edge would be lost. Frame: ticks the loop came late for
+} probeStat;
+
+typedef struct {
+    probeStat stats[PROBES];
+    uint8_t fps;                      // Frames drawn in the last second
+    uint8_t frames;
+} probeStats;
+
+#if USE_PROBE == 1
+    // Plain memory, found by its symbol from a debugger or simulator - copy it with interrupts disabled
+    extern probeStats probe;
+
+    __attribute__((always_inline)) static inline void probeAdd(uint8_t id, uint16_t elapsed, uint8_t missed) {
+        probeStat *s = &probe.stats[id];
+
+        if(elapsed < s->min) s->min = elapsed;
+        if(elapsed > s->max) s->max = elapsed;
+        s->total += elapsed;
+        ++s->count;
+        if(missed) ++s->misses;
+    }
+
+    // Only the low byte of TIMER0 - nothing measured with it takes 256 ticks
+    #define PROBE_START(t)            uint8_t t = TCNT0
+    #define PROBE_END(id, t, missed)  probeAdd(id, (uint8_t)(TCNT0 - t), missed)
+
+    #define PROBE_FRAME_START(t)      uint32_t t = ticks_now()
+    #define PROBE_FRAME_END(t, late)  probeFrame(ticks_now() - t, late)
+
+    void probeReset(void);
+    void probeFrame(unsigned long int elapsed, uint8_t late);
+    void probeSecond(void);
+#else
+    #define PROBE_START(t)
+    #define PROBE_END(id, t, missed)
+    #define PROBE_FRAME_START(t)
+    #define PROBE_FRAME_END(t, late)
+#endif
+
+#endif  // PROBE_H
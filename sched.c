@@ -0,0 +1,97 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#include <avr/pgmspace.h>
+
+#include "sched.h"
+#include "millis.h"
+
+schedState schedStates[SCHED_TASKS];
+
+static const schedTask *tasks;
+static uint8_t taskCount = 0;
+
+
+// TIMER1 in CTC mode, a compare match every 0.25s - constants from F_CPU
+void schedTimerInit(void) {
+    TCCR1A = 0;
+    OCR1A = SCHED_COMPARE;               // Counts from 0 to OCR1A
+    schedCompare();                      // ... or one more, the first tick is set up as any other
+    TCNT1 = 0;
+    TCCR1B = (1<<WGM12) | SCHED_CS;      // Hardware restarts the count, no reload in the ISR
+    TIMSK1 |= (1<<OCIE1A);
+}
+
+// OCR1A isn't buffered in CTC mode - written right after the match, it ends the tick that has just started.
+// That tick's own short cycles are counted before its length is picked, so it never ends a whole count late
+void schedCompare(void) {
+#if SCHED_FRACT_CYCLES
+    static uint16_t fract = 0;
+
+    fract += SCHED_FRACT_CYCLES;
+    if(fract >= SCHED_PRESCALER) {
+        fract -= SCHED_PRESCALER;
+        OCR1A = SCHED_COMPARE + 1;
+    } else OCR1A = SCHED_COMPARE;
+#endif
+}
+
+void schedInit(const schedTask *table, uint8_t count) {
+    register uint8_t i;
+
+    tasks = table;
+    taskCount = count;
+
+    for(i = 0; i != count; ++i) {
+        schedStates[i].left = pgm_read_word(&table[i].first);
+        schedStates[i].misses = 0;
+        schedStates[i].worst = 0;
+    }
+}
+
+// Runs every task that became due in `elapsed` ticks - more than one tick means the main loop fell behind
+void schedTicks(uint8_t elapsed) {
+    schedState *state;
+    schedTask task;
+    uint32_t start, took;
+    register uint8_t i;
+
+    for(i = 0; i != taskCount; ++i) {
+        state = &schedStates[i];
+        if(!state->left) continue;
+        if(state->left > elapsed) {
+            state->left -= elapsed;
+            continue;
+        }
+
+        if(state->left < elapsed && state->misses != 0xFF) ++state->misses;
+
+        // Re-armed before the run, so the task may still move itself with `schedAfter()`
+        memcpy_P(&task, &tasks[i], sizeof(schedTask));
+        state->left = task.period;
+
+        start = ticks_now();
+        task.run();
+        took = ticks_now() - start;
+        if(took > state->worst) state->worst = (took > 0xFFFF) ? 0xFFFF : took;
+    }
+}
+
+void schedAfter(uint8_t task, uint16_t after) {schedStates[task].left = after;}
@@ -0,0 +1,85 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <avr/io.h>
+#include <stdint.h>
+
+// Cooperative scheduler counting 0.25s TIMER1 ticks - tasks run from the main loop, one after another
+#define SCHED_TASKS 8                 // Tasks in a table at most
+
+// TIMER1 in CTC mode clears itself on OCR1A match, so ISR latency never adds to the tick.
+// Smallest prescaler that fits the compare value in 16 bits - the finest resolution
+#define SCHED_HZ 4
+
+#if F_CPU / SCHED_HZ < 65536
+    #define SCHED_PRESCALER 1
+    #define SCHED_CS (1<<CS10)
+#elif F_CPU / (8 * SCHED_HZ) < 65536
+    #define SCHED_PRESCALER 8
+    #define SCHED_CS (1<<CS11)
+#elif F_CPU / (64 * SCHED_HZ) < 65536
+    #define SCHED_PRESCALER 64
+    #define SCHED_CS ((1<<CS11) | (1<<CS10))
+#elif F_CPU / (256 * SCHED_HZ) < 65536
+    #define SCHED_PRESCALER 256
+    #define SCHED_CS (1<<CS12)
+#else
+    #define SCHED_PRESCALER 1024
+    #define SCHED_CS ((1<<CS12) | (1<<CS10))
+#endif
+
+// Whole timer counts per tick: 62500 at 16 MHz, 31250 at 8 MHz, 19531 (/256) at 20 MHz. The cycles a tick
+// comes short of F_CPU/SCHED_HZ (64 at 20 MHz) are added up by `schedCompare()`, which lengthens a tick by
+// one count whenever they make a whole one - the tick is never more than one count off and doesn't drift
+#define SCHED_COUNTS (F_CPU / SCHED_HZ / SCHED_PRESCALER)
+#define SCHED_COMPARE (SCHED_COUNTS - 1)
+#define SCHED_FRACT_CYCLES (F_CPU / SCHED_HZ - SCHED_COUNTS * SCHED_PRESCALER)
+
+#if F_CPU % SCHED_HZ
+    #error "F_CPU has to be a whole number of SCHED_HZ ticks"
+#endif
+
+_Static_assert(SCHED_COUNTS < 65536, "TIMER1 compare value doesn't fit 16 bits");
+
+// Task table entry, kept in PROGMEM
+typedef struct {
+    void (*run)(void);
+    uint16_t period;                  // Ticks between runs, 0 - one-shot, armed with `schedAfter()`
+    uint16_t first;                   // Ticks until the first run, 0 - not armed
+} schedTask;
+
+typedef struct {
+    uint16_t left;                    // Ticks until the next run, 0 - not armed
+    uint8_t  misses;                  // Runs that came later than their tick
+    uint16_t worst;                   // Longest run, TIMER0 ticks (TICK_CYCLES)
+} schedState;
+
+extern schedState schedStates[SCHED_TASKS];
+
+void schedTimerInit(void);
+void schedCompare(void);                     // From the compare match ISR, sets the length of the tick under way
+void schedInit(const schedTask *table, uint8_t count);
+void schedTicks(uint8_t elapsed);
+void schedAfter(uint8_t task, uint16_t after);
+
+#endif  // SCHED_H
@@ -0,0 +1,128 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#include <avr/interrupt.h>
+#include "speed.h"
+
+speedValues speedNow;
+
+volatile uint16_t speedEdges = 0;
+volatile uint32_t speedTimes[SPEED_EDGES];
+volatile uint8_t speedTimed = 0, speedCounting = 0;
+
+static uint32_t speedScale = 0;           // 0.1 km/h for one edge per tick
+
+static uint32_t lastUpdate = 0;
+static uint16_t lastEdges = 0;
+
+static uint16_t gateEdges[SPEED_GATES];   // Edges and ticks of the last updates
+static uint16_t gateTicks[SPEED_GATES];
+static uint16_t gateEdgeSum = 0;
+static uint32_t gateTickSum = 0;
+static uint8_t  gate = 0;
+
+
+void speedCalibrate(float pulseDistance) {
+    // Negated comparison also catches NaN of erased EEPROM
+    speedScale = !(pulseDistance > 0) ? 0 : (uint32_t)(pulseDistance * 36000.0f * F_CPU / TICK_CYCLES + 0.5f);
+}
+
+static uint16_t speedOf(uint16_t edges, uint32_t ticks) {
+    uint64_t v = (uint64_t)speedScale * edges / ticks;
+    return (v > 0xFFFF) ? 0xFFFF : v;
+}
+
+// Period of the last edges - as many as fit in SPEED_SPAN, at least one
+static uint16_t speedPeriod(uint32_t now) {
+    uint32_t times[SPEED_EDGES], newest, span;
+    uint16_t edges, v;
+    uint8_t timed, n;
+
+    cli();
+    edges = speedEdges;
+    timed = speedTimed;
+    for(n = 0; n != SPEED_EDGES; ++n) times[n] = speedTimes[n];
+    sei();
+
+    if(!timed) return 0;
+    newest = times[edges & (SPEED_EDGES-1)];
+    if(now - newest > SPEED_TIMEOUT) {
+        speedNow.stopped = 1;
+        return 0;
+    } speedNow.stopped = 0;
+    if(timed < 2) return 0;
+
+    for(n = 1; n + 1 < timed && newest - times[(edges - n - 1) & (SPEED_EDGES-1)] <= SPEED_SPAN; ++n);
+    span = newest - times[(edges - n) & (SPEED_EDGES-1)];
+    v = speedOf(n, span);
+
+    // Without an edge for longer than the last period, the car must be going slower
+    if(now - newest > span / n) {
+        uint16_t slower = speedOf(1, now - newest);
+        if(slower < v) v = slower;
+    }
+    return v;
+}
+
+uint8_t speedUpdate(void) {
+    uint32_t now = ticks_now(), elapsed = now - lastUpdate;
+    uint16_t edges, rate, shown = speedNow.speed / 10;
+
+    if(elapsed < SPEED_TICKS) return 0;
+    lastUpdate = now;
+    if(elapsed > 0xFFFF) elapsed = 0xFFFF;  // Main loop held up for long
+
+    cli();
+    edges = speedEdges;
+    sei();
+
+    // Edges over the gates are always kept, they decide the method
+    gateEdgeSum += (edges - lastEdges) - gateEdges[gate];
+    gateTickSum += elapsed - gateTicks[gate];
+    gateEdges[gate] = edges - lastEdges;
+    gateTicks[gate] = elapsed;
+    if(++gate == SPEED_GATES) gate = 0;
+    lastEdges = edges;
+
+    rate = (uint32_t)gateEdgeSum * TICKS_PER_S / gateTickSum;
+
+    if(speedCounting) {
+        speedNow.speed = speedOf(gateEdgeSum, gateTickSum);
+        speedNow.stopped = !gateEdgeSum;
+
+        if(rate < SPEED_COUNT_OFF) {
+            // Timestamps start over, there are plenty of them by the next update
+            cli();
+            speedTimed = 0;
+            speedCounting = 0;
+            sei();
+        }
+    } else {
+        speedNow.speed = speedPeriod(now);
+        if(rate >= SPEED_COUNT_ON) {
+            cli();
+            speedCounting = 1;
+            sei();
+        }
+    }
+    speedNow.counting = speedCounting;
+
+    return speedNow.speed / 10 != shown;
+}
@@ -0,0 +1,64 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#ifndef SPEED_H
+#define SPEED_H
+
+#include <stdint.h>
+#include "millis.h"
+
+// Speed from VSS edges, 10 times a second. At low speed it's the time between the last edges,
+// timestamped by INT0 - at high speed edges are only counted over the last SPEED_GATES updates,
+// which keeps INT0 short. Switches by the edge rate, with hysteresis
+#define SPEED_HZ        10
+#define SPEED_TICKS     (TICKS_PER_S / SPEED_HZ)           // Between updates
+#define SPEED_EDGES     8                 // Timestamps kept, a power of 2
+#define SPEED_SPAN      MS_TO_TICKS(500)                   // Periods are averaged over the edges of the last 0.5s
+#define SPEED_TIMEOUT   MS_TO_TICKS(2000)                  // No edge for 2s - standing
+#define SPEED_GATES     5                 // Updates added up while counting
+#define SPEED_COUNT_ON  400               // Edges per second to start counting
+#define SPEED_COUNT_OFF 320               // ... and to go back to periods
+
+typedef struct {
+    uint16_t speed;                       // 0.1 km/h
+    uint8_t  counting;                    // 1 - counted over the gates, 0 - from edge periods
+    uint8_t  stopped;                     // No edge for SPEED_TIMEOUT
+} speedValues;
+
+extern speedValues speedNow;
+
+// Written by `speedEdge()` from INT0
+extern volatile uint16_t speedEdges;
+extern volatile uint32_t speedTimes[SPEED_EDGES];
+extern volatile uint8_t speedTimed, speedCounting;
+
+// Call from the VSS interrupt, with interrupts disabled
+__attribute__((always_inline)) static inline void speedEdge(void) {
+    ++speedEdges;
+    if(speedCounting) return;
+
+    speedTimes[speedEdges & (SPEED_EDGES-1)] = ticks();
+    if(speedTimed < SPEED_EDGES) ++speedTimed;
+}
+
+void speedCalibrate(float pulseDistance);  // km per VSS pulse
+uint8_t speedUpdate(void);                 // From the main loop - 1 when the shown km/h have changed
+
+#endif  // SPEED_H
@@ -0,0 +1,93 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#include <avr/eeprom.h>
+#include <stddef.h>
+#include <util/crc16.h>
+
+#include "store.h"
+#include "persist.h"
+
+// Packed - on the AVR it's the same, wider hosts would leave padding the CRC doesn't cover
+typedef struct {
+    uint16_t seq;
+    storeRecord record;
+    uint16_t crc;
+} __attribute__((packed)) storeSlot;
+
+static storeSlot EEMEM slots[STORE_SLOTS];
+
+static uint8_t  nextSlot = 0;
+static uint16_t nextSeq  = 0;
+
+
+static uint16_t slotCRC(const storeSlot *slot) {
+    const uint8_t *data = (const uint8_t*)slot;
+    uint16_t crc = _crc_ccitt_update(0xFFFF, STORE_FORMAT);
+    register uint8_t i;
+
+    for(i = 0; i != offsetof(storeSlot, crc); ++i) crc = _crc_ccitt_update(crc, data[i]);
+    return crc;
+}
+
+// Finds the newest record with a valid CRC, returns 0 if there's none (erased EEPROM)
+uint8_t storeLoad(storeRecord *record) {
+    storeSlot slot;
+    uint16_t seq = 0;
+    register uint8_t i, newest = STORE_SLOTS;
+
+    // Every slot is read whole, only records with a valid CRC are ordered - a flipped bit in the
+    // sequence number of a torn one could make an older record look newer than the newest
+    for(i = 0; i != STORE_SLOTS; ++i) {
+        eeprom_read_block(&slot, &slots[i], sizeof(storeSlot));
+        if(slot.crc != slotCRC(&slot)) continue;  // Torn or erased
+        if(newest != STORE_SLOTS && (int16_t)(slot.seq - seq) <= 0) continue;
+
+        newest = i;
+        seq = slot.seq;
+        *record = slot.record;
+    }
+
+    if(newest != STORE_SLOTS) {
+        nextSlot = (newest + 1 == STORE_SLOTS) ? 0 : newest + 1;
+        nextSeq  = seq + 1;
+        return 1;
+    }
+
+    // Empty ring starts at its last slot, away from the struct the first firmware kept at the start of EEPROM
+    nextSlot = STORE_SLOTS - 1;
+    nextSeq  = 0;
+    return 0;
+}
+
+// Queues the record into the slot after the newest one, returns 0 if the EEPROM queue is full
+uint8_t storeSave(const storeRecord *record) {
+    storeSlot slot;
+
+    slot.seq = nextSeq;
+    slot.record = *record;
+    slot.crc = slotCRC(&slot);
+
+    if(!persistWrite(&slots[nextSlot], &slot, sizeof(storeSlot))) return 0;
+
+    nextSlot = (nextSlot + 1 == STORE_SLOTS) ? 0 : nextSlot + 1;
+    ++nextSeq;
+    return 1;
+}
@@ -0,0 +1,40 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#ifndef STORE_H
+#define STORE_H
+
+#include <stdint.h>
+#include "trip.h"
+
+// Trip state is appended to a ring of EEPROM slots instead of rewriting the same bytes every save,
+// so every cell is written once per STORE_SLOTS saves. Records carry a sequence number and CRC
+#define STORE_SLOTS 18                // 18 * 56 bytes, the rest of 1 KB is taken by settings
+#define STORE_FORMAT 1                // Goes into the CRC - bumped when `storeRecord` changes meaning, so older records are ignored
+
+typedef struct {
+    tripCounters trip;
+    long savedFuel;                   // mL
+} storeRecord;
+
+uint8_t storeLoad(storeRecord *record);
+uint8_t storeSave(const storeRecord *record);
+
+#endif  // STORE_H
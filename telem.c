@@ -0,0 +1,101 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/crc16.h>
+
+#include "telem.h"
+
+#define BUFFER_MASK (TELEM_BUFFER - 1)
+
+static uint8_t encoded[TELEM_BUFFER];
+
+// Free running indexes - the head is moved by the main loop, the tail by the ISR
+static volatile uint8_t head = 0, tail = 0;
+
+static uint16_t seq = 0;
+static uint8_t dropped = 0;
+
+volatile uint16_t telemDropped = 0;
+
+
+void telemInit(void) {
+    UBRR0 = TELEM_UBRR;
+    UCSR0A = (1<<U2X0);
+    UCSR0C = (1<<UCSZ01) | (1<<UCSZ00);   // 8N1
+    UCSR0B = (1<<TXEN0);                  // Transmit only, UDRE interrupt is enabled when there's something to send
+}
+
+// Stamps the frame, encodes it and queues it whole - returns 0 if it didn't fit, the UART is never waited for
+uint8_t telemSend(telemFrame *frame) {
+    uint8_t raw[sizeof(telemFrame) + 2];
+    uint8_t out[TELEM_ENCODED];
+    uint8_t *p = (uint8_t*)frame;
+    uint16_t crc = 0xFFFF;
+    register uint8_t i, n = 0, code = 0;
+
+    frame->seq = seq++;
+    frame->dropped = dropped;
+
+    for(i = 0; i != sizeof(telemFrame); ++i) {
+        raw[i] = p[i];
+        crc = _crc_ccitt_update(crc, p[i]);
+    }
+    raw[i++] = crc & 0xFF;
+    raw[i]   = crc >> 8;
+
+    // COBS - every zero is replaced by the distance to the next one, so 0x00 only ends frames
+    for(i = 0; i != sizeof(raw); ++i) {
+        if(raw[i]) out[++n] = raw[i];
+        else {
+            out[code] = n - code + 1;
+            code = ++n;
+        }
+    }
+    out[code] = n - code + 1;
+    out[++n] = 0;
+    ++n;
+
+    if((uint8_t)(head - tail) + n > TELEM_BUFFER) {
+        if(dropped != 0xFF) ++dropped;
+        ++telemDropped;
+        return 0;
+    }
+
+    for(i = 0; i != n; ++i) encoded[(uint8_t)(head + i) & BUFFER_MASK] = out[i];
+    head += n;                        // Frame is visible to the ISR from now on
+
+    dropped = 0;
+    UCSR0B |= (1<<UDRIE0);
+    return 1;
+}
+
+
+// Data register empty - one byte per interrupt
+ISR(USART_UDRE_vect) {
+    if(head == tail) {
+        UCSR0B &= ~(1<<UDRIE0);
+        return;
+    }
+
+    UDR0 = encoded[tail & BUFFER_MASK];
+    ++tail;
+}
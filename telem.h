@@ -0,0 +1,61 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#ifndef TELEM_H
+#define TELEM_H
+
+#include <stdint.h>
+
+#ifndef USE_TELEMETRY
+    #define USE_TELEMETRY 1           // 1 - stream tick frames over USART0 (PD1/TXD);  0 - compiled out
+#endif
+
+// 8N1 at 500 kbaud, double speed - exact for 8, 16 and 20 MHz, and a standard rate for host serial ports
+#define TELEM_BAUD   500000L
+#define TELEM_UBRR   (F_CPU / (8 * TELEM_BAUD) - 1)
+#define TELEM_BUFFER 64               // Encoded bytes waiting for the UART, power of two up to 128
+
+_Static_assert(F_CPU % (8 * TELEM_BAUD) == 0, "F_CPU can't make the telemetry baud rate exactly");
+
+// Frame sent every tick, little endian and packed - followed by CRC-16/CCITT (0xFFFF, reflected),
+// then COBS encoded and ended with 0x00. Decoded by `tools/telemetry.py`
+typedef struct __attribute__((packed)) {
+    uint16_t seq;                     // Counts every frame, also the dropped ones
+    uint8_t  ticks;                   // TIMER1 ticks covered, more than 1 when the main loop came late
+    uint8_t  dropped;                 // Frames dropped since the previous one sent, saturates at 255
+    uint16_t pulses;                  // VSS pulses
+    uint32_t injTicks;                // Injector open time, TIMER0 ticks (TICK_CYCLES)
+    uint16_t speed;                   // 0.1 km/h, as shown
+    uint8_t  flags;
+    uint16_t adc;                     // Last fuel level reading
+} telemFrame;
+
+#define TELEM_CALIBRATION (1<<0)      // Calibration mode - pulses are counted but not driven
+#define TELEM_FUNC        (1<<1)      // FUNC button held
+
+// Frame, CRC and COBS overhead byte, delimiter
+#define TELEM_ENCODED (sizeof(telemFrame) + 2 + 1 + 1)
+
+extern volatile uint16_t telemDropped;    // Frames that didn't fit the buffer
+
+void telemInit(void);
+uint8_t telemSend(telemFrame *frame);
+
+#endif  // TELEM_H
@@ -0,0 +1,119 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+
+// millis() and micros() against the cycles of the simulated chip, built at 8, 16 and 20 MHz - every
+// TIMER0 overflow of a drive longer than the 2^32 ticks `ticks()` wraps after. Both have to be exactly
+// the whole ms and us gone by, at every overflow and at a different phase of every one, so neither
+// may drift or jump where the tick counter wraps. Then the TIMER1 scheduler tick over an hour, from the
+// compare values the firmware writes and the prescaler the datasheet gives its CS1x bits
+
+#include <stdio.h>
+
+#include <avr/io.h>
+
+#include "host.h"
+#include "millis.h"
+#include "sched.h"
+#include "test.h"
+
+#define OVERFLOWS ((1UL<<24) + 100000)  // 2^32 ticks and some more - 4.8 h at 16 MHz, 3.8 h at 20 MHz
+#define HOUR ((uint64_t)F_CPU * 3600)
+
+void TIMER0_OVF_vect(void);
+
+
+// Cycles of one TIMER1 count, by CS12:0 - table 15-6 of the ATmega328P datasheet
+static uint32_t prescaler(void) {
+    static const uint16_t CLOCK[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+    return CLOCK[TCCR1B & ((1<<CS12) | (1<<CS11) | (1<<CS10))];
+}
+
+// Every compare match of an hour - the cycles gone by can't be more than one count ahead or behind exact
+// F_CPU/SCHED_HZ ticks, and at 8, 16 and 20 MHz a whole second of ticks is exact
+static void scheduler(void) {
+    unsigned long n, wrongTicks = 0;
+    int64_t off, worst = 0;
+    uint64_t at = 0;
+
+    schedTimerInit();
+    CHECK("TIMER1 in CTC mode, compare match interrupt", (TCCR1B & (1<<WGM12)) && !(TCCR1B & (1<<WGM13))
+          && !(TCCR1A & ((1<<WGM11) | (1<<WGM10))) && (TIMSK1 & (1<<OCIE1A)));
+
+    for(n = 1; n <= 3600UL * SCHED_HZ; ++n) {
+        at += (OCR1A + 1ULL) * prescaler();
+        schedCompare();
+
+        off = (int64_t)at - (int64_t)n * (F_CPU / SCHED_HZ);
+        if(off < 0) off = -off;
+        if(off > worst) worst = off;
+        wrongTicks += off >= prescaler() || (n % SCHED_HZ == 0 && off);
+    }
+
+    CHECK_NEAR("drift after an hour, cycles", (double)((int64_t)at - (int64_t)HOUR), 0, 0);
+    CHECK_RANGE("worst tick, cycles off", (double)worst, 0, prescaler() - 1);
+    CHECK_NEAR("ticks out of step", wrongTicks, 0, 0);
+}
+
+
+int main(void) {
+    unsigned long n, wrongMillis = 0, wrongMicros = 0, hourMillis = 0;
+    uint32_t before = 0, expected;
+    uint8_t wrapped = 0;
+    uint64_t at;
+    char what[64];
+
+    TCCR0B = (1<<CS01) | (1<<CS00);   // Prescaler 64 as `main()` sets it
+    hostT0Next = OVERFLOW_CYCLES;
+
+    snprintf(what, sizeof(what), "%lu MHz", (unsigned long)TICK_MHZ);
+    testCase(what);
+
+    for(n = 1; n <= OVERFLOWS; ++n) {
+        // Somewhere within the overflow before this one - a different phase every time
+        at = hostT0Next - OVERFLOW_CYCLES + n * 4099 % OVERFLOW_CYCLES;
+        hostNow = at;
+        expected = (at / TICK_CYCLES * TICK_CYCLES) / TICK_MHZ;   // Whole ticks are all TIMER0 can tell
+        wrongMicros += micros() != expected;
+
+        // Overflow pending, ISR not run yet - `micros()` has to count it itself
+        hostNow = hostT0Next;
+        wrongMicros += micros() != (uint32_t)(hostNow / TICK_MHZ);
+
+        hostT0Next += OVERFLOW_CYCLES;
+        TIFR0 &= ~(1<<TOV0);
+        TIMER0_OVF_vect();
+
+        wrongMillis += millis() != hostNow / CYCLES_PER_MS;
+        wrongMicros += micros() != (uint32_t)(hostNow / TICK_MHZ);
+        if(hostNow <= HOUR) hourMillis = millis();
+        wrapped |= ticks() < before;
+        before = ticks();
+    }
+
+    CHECK_NEAR("millis after an hour, ms", hourMillis, (double)(HOUR / OVERFLOW_CYCLES * OVERFLOW_CYCLES / CYCLES_PER_MS), 0);
+    CHECK_NEAR("overflows millis is off at", wrongMillis, 0, 0);
+    CHECK_NEAR("readings micros is off at", wrongMicros, 0, 0);
+    CHECK("ticks() wrapped on the way", wrapped);
+
+    testCase("TIMER1 scheduler tick");
+    scheduler();
+    return testEnd();
+}
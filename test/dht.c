@@ -0,0 +1,123 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+
+// DHT11 frames replayed as falling edges at known times against TIMER0 of the simulated chip -
+// nominal timing, bits right at the edge of what the 100 us threshold tells apart, and frames the
+// checksum or their length must reject. Every frame is replayed at every microsecond of the 4 us
+// tick, so edges land on every phase of TIMER0
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dht.h"
+#include "host.h"
+#include "test.h"
+
+#define RESPONSE_US 160               // 80 us low and 80 us high before the first bit
+#define PHASES (TICK_CYCLES / TICK_MHZ)  // Microseconds in one tick
+
+// Humidity 45.0 %, temperature -12.3 C
+static const uint8_t FRAME[5] = {45, 0, 0x80 | 12, 3, (45 + 0 + (0x80 | 12) + 3) & 0xFF};
+
+
+// Falling edges of `bytes` as the sensor sends them, `bits` of them, starting `phase` us into a tick.
+// Returns 1 if the decoded frame is the one sent
+static uint8_t replay(const uint8_t *bytes, uint8_t bits, double zero, double one, uint8_t phase, DHT *dht) {
+    double at = phase + 1000;
+    uint8_t i;
+
+    hostNow = at * TICK_MHZ;
+    dhtStart();
+    dhtListen();
+
+    // Sensor answers 30 us after the line is released, then every bit starts with a falling edge
+    at += 30;
+    hostNow = at * TICK_MHZ;
+    dhtEdge();
+    at += RESPONSE_US;
+    hostNow = at * TICK_MHZ;
+    dhtEdge();
+
+    for(i = 0; i != bits; ++i) {
+        at += (bytes[i/8] & (0x80 >> i%8)) ? one : zero;
+        hostNow = at * TICK_MHZ;
+        dhtEdge();
+    }
+    return dhtDecode(dht);
+}
+
+// Frames decoded at every phase, and how many of them came out as sent
+static void frames(const char *what, const uint8_t *bytes, uint8_t bits, double zero, double one, unsigned expected) {
+    unsigned decoded = 0, right = 0;
+    char label[64];
+    uint8_t phase;
+    DHT dht;
+
+    for(phase = 0; phase != PHASES; ++phase) {
+        if(!replay(bytes, bits, zero, one, phase, &dht)) continue;
+        ++decoded;
+        right += dht.humidity == 45.0f && dht.temperature == -12.3f;
+    }
+
+    snprintf(label, sizeof(label), "%s, decoded", what);
+    CHECK_NEAR(label, decoded, expected, 0);
+    snprintf(label, sizeof(label), "%s, as sent", what);
+    CHECK_NEAR(label, right, expected, 0);
+}
+
+
+static void nominal(void) {
+    testCase("nominal - 78 us zeros, 120 us ones");
+    frames("datasheet timing", FRAME, 40, 78, 120, PHASES);
+    frames("slow sensor, 84/128 us", FRAME, 40, 84, 128, PHASES);
+    frames("fast sensor, 72/112 us", FRAME, 40, 72, 112, PHASES);
+}
+
+static void marginal(void) {
+    testCase("marginal - a tick either side of the 100 us threshold");
+    frames("96 us zeros, 108 us ones", FRAME, 40, 96, 108, PHASES);
+    frames("104 us zeros, read as ones", FRAME, 40, 104, 120, 0);
+}
+
+static void rejected(void) {
+    uint8_t bytes[5];
+
+    testCase("rejected - checksum and length");
+    memcpy(bytes, FRAME, sizeof(bytes));
+    bytes[4] ^= 0x01;
+    frames("wrong checksum", bytes, 40, 78, 120, 0);
+
+    memcpy(bytes, FRAME, sizeof(bytes));
+    bytes[1] ^= 0x10;
+    frames("flipped data bit", bytes, 40, 78, 120, 0);
+
+    frames("39 bits", FRAME, 39, 78, 120, 0);
+}
+
+
+int main(void) {
+    TCCR0B = (1<<CS01) | (1<<CS00);   // Prescaler 64, as `main()` sets it
+
+    nominal();
+    marginal();
+    rejected();
+    return testEnd();
+}
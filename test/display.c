@@ -0,0 +1,137 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+
+// Text blitter against a pixel by pixel reference of the same font, on the in-memory display.
+// Also times both ways of drawing a character - host nanoseconds, they only compare the two
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "display.h"
+#include "chars.h"
+#include "test.h"
+
+#define BYTES (MOCK_WIDTH*MOCK_HEIGHT/8)
+#define TEXT "08.5L/100km"
+#define RUNS 20000
+
+static uint8_t background[BYTES], reference[BYTES];
+
+
+static void setPixel(uint8_t *screen, uint8_t x, uint8_t y, uint8_t on) {
+    uint8_t *byte = &screen[(y >> 3)*MOCK_WIDTH + x];
+
+    if(x >= MOCK_WIDTH || y >= MOCK_HEIGHT) return;
+    if(on) *byte |= 1 << (y & 7);
+    else *byte &= ~(1 << (y & 7));
+}
+
+static void referenceChar(uint8_t x, uint8_t y, char code, uint8_t scale) {
+    uint8_t column, row;
+
+    for(column = 0; column != 5*scale; ++column)
+        for(row = 0; row != 7*scale; ++row)
+            setPixel(reference, x + column, y + row, CHARSET[code-32][column/scale] & (1 << row/scale));
+}
+
+// What text cost before the blitter - every pixel through the backend on its own
+static void pixelChar(uint8_t x, uint8_t y, char code, uint8_t scale) {
+    uint8_t column, row;
+
+    for(column = 0; column != 5*scale; ++column)
+        for(row = 0; row != 7*scale; ++row)
+            if(x + column < MOCK_WIDTH) displayColumn(x + column, y + row, (CHARSET[code-32][column/scale] >> row/scale) & 1, 1);
+}
+
+
+static void blit(void) {
+    static const char codes[] = "08%W|";
+    char what[48];
+    uint8_t scale, y, i, bad;
+    unsigned n;
+
+    testCase("blit - every scale at every row offset, over a background");
+    for(n = 0; n != BYTES; ++n) background[n] = n*37 + 11;
+
+    for(scale = 1; scale <= 4; ++scale) {
+        for(bad = 0, y = 0; y != 8; ++y) {
+            for(i = 0; codes[i]; ++i) {
+                memcpy(mockScreen, background, BYTES);
+                memcpy(reference, background, BYTES);
+                displayCursor(3, y + (scale < 4 ? 8 : 0));
+                displayCharN(codes[i], scale);
+                referenceChar(3, y + (scale < 4 ? 8 : 0), codes[i], scale);
+                bad += memcmp(mockScreen, reference, BYTES) != 0;
+            }
+        }
+        sprintf(what, "scale %u matches the reference", scale);
+        CHECK(what, !bad);
+    }
+
+    // Right edge clips, the rest of the line is left alone
+    memcpy(mockScreen, background, BYTES);
+    memcpy(reference, background, BYTES);
+    displayCursor(80, 5);
+    displayCharN('8', 3);
+    referenceChar(80, 5, '8', 3);
+    CHECK("clipped at the right edge", !memcmp(mockScreen, reference, BYTES));
+}
+
+static double nsPerChar(uint8_t scale, uint8_t pixels) {
+    struct timespec start, end;
+    unsigned run;
+    const char *c;
+    uint8_t x;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(run = 0; run != RUNS; ++run) {
+        for(c = TEXT, x = 0; *c; ++c, x += 5*scale + 1) {
+            if(pixels) pixelChar(x, 1 + run % 8, *c, scale);
+            else {
+                displayCursor(x, 1 + run % 8);
+                displayCharN(*c, scale);
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return ((end.tv_sec - start.tv_sec)*1e9 + (end.tv_nsec - start.tv_nsec)) / RUNS / (sizeof(TEXT) - 1);
+}
+
+static void bench(void) {
+    uint8_t scale;
+    double blitted, pixels;
+
+    testCase("bench - ns per character, \"" TEXT "\" at odd rows");
+    for(scale = 1; scale <= 2; ++scale) {
+        pixels = nsPerChar(scale, 1);
+        blitted = nsPerChar(scale, 0);
+        printf("       scale %u: %.0f per pixel, %.0f blitted\n", scale, pixels, blitted);
+        CHECK(scale == 1 ? "scale 1 blitted faster" : "scale 2 blitted faster", blitted < pixels);
+    }
+}
+
+
+int main(void) {
+    blit();
+    bench();
+    return testEnd();
+}
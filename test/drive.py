@@ -0,0 +1,268 @@
+#!/usr/bin/env python3
+#  Universal Board Computer for cars with electronic MPI
+#  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+#
+#  This file is part of UBC.
+#  UBC is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU Affero General Public License as
+#  published by the Free Software Foundation, either version 3 of the
+#  License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#  See the GNU Affero General Public License for more details.
+#
+#  You should have received a copy of the GNU Affero General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+# <https://itcrowd.net.pl/>
+
+
+# Drives the whole firmware on the host build (`make host`) with known VSS and injector trains
+# and checks what it counts and shows. Run by `make test`:
+#   python3 test/drive.py
+# Exits with 1 when any value is off by more than its tolerance.
+
+import math
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+HOST = os.path.join(os.path.dirname(__file__), "..", "build", "host", "ubc")
+
+F_CPU = 16000000
+TICK_CYCLES = 64
+PULSE_DISTANCE = 0.00006823   # km per VSS pulse - host default calibration
+INJECTION = 0.0025            # L/s through one injector
+INJECTORS = 4
+SAVE_INTERVAL = 60            # s
+SLOT = 56                     # Bytes of a trip record in EEPROM
+LAG = 1.25                    # s - counts reach the trip once a second, after the tick that ends it
+
+SUMMARY = {
+    "pulses":   r"counters\s+(\d+) VSS pulses",
+    "ticks":    r"counters.*, (\d+) injector ticks",
+    "distance": r"distance\s+([\d.]+) km",
+    "fuel":     r"fuel\s+([\d.]+) L",
+    "speed":    r"speed\s+(\d+) km/h",
+    "shown":    r"shown ([\d.]+) km/h",
+    "instant":  r"consumption ([\d.]+) now",
+    "average":  r"now, ([\d.]+) L/100km average",
+    "eeprom":   r"EEPROM bytes programmed (\d+)",
+}
+
+failed = 0
+
+
+def run(*args):
+    out = subprocess.run([HOST] + [str(a) for a in args], stdout=subprocess.PIPE, universal_newlines=True, check=True).stdout
+    values = {}
+    for name, pattern in SUMMARY.items():
+        match = re.search(pattern, out)
+        if not match:
+            sys.exit("%s missing from the output of %s" % (name, " ".join(str(a) for a in args)))
+        values[name] = float(match.group(1))
+    return values
+
+
+def check(what, value, low, high):
+    global failed
+    ok = low <= value <= high
+    if not ok:
+        failed += 1
+    print("  %-4s %-40s %.6g (%.6g - %.6g)" % ("ok" if ok else "FAIL", what, value, low, high))
+
+
+def near(what, value, expected, tolerance):
+    check(what, value, expected - tolerance, expected + tolerance)
+
+
+def pulses(speed, seconds):
+    return speed / 3600 * seconds / PULSE_DISTANCE
+
+
+def injections(rpm, seconds):
+    return int(seconds * rpm / 120)
+
+
+def ticks(width):
+    return width / 1000 * F_CPU / TICK_CYCLES
+
+
+def litres(injectorTicks):
+    return injectorTicks * TICK_CYCLES / F_CPU * INJECTION * INJECTORS
+
+
+def cruise(speed, rpm, width, hours, note=""):
+    seconds = hours * 3600
+    print("cruise - %d km/h, %d rpm, %d ms for %g h%s" % (speed, rpm, width, hours, note))
+    v = run("-s", speed, "-r", rpm, "-w", width, "-t", hours)
+
+    # Last pulse and injection fall on the end of the run and aren't counted
+    check("VSS pulses", v["pulses"], pulses(speed, seconds - LAG) - 1, pulses(speed, seconds))
+    check("injector ticks", v["ticks"], injections(rpm, seconds - LAG) * ticks(width), injections(rpm, seconds) * ticks(width))
+    near("whole injections", v["ticks"] % ticks(width), 0, 0)
+    near("distance, km", v["distance"], v["pulses"] * PULSE_DISTANCE, 0.001)
+    near("fuel, L", v["fuel"], litres(v["ticks"]), 0.001)
+    near("speed, km/h", v["speed"], speed, 1)
+    near("shown speed, km/h", v["shown"], speed, 0.5)
+    # A second holds whole injections and pulses, either side of the rate
+    per, pps = rpm / 120, pulses(speed, 1)
+    check("instant, L/100km", v["instant"], litres(ticks(width)) * math.floor(per) / (math.ceil(pps) * PULSE_DISTANCE) * 100 - 0.01,
+          litres(ticks(width)) * math.ceil(per) / (math.floor(pps) * PULSE_DISTANCE) * 100)
+    near("average, L/100km", v["average"], v["fuel"] / v["distance"] * 100, 0.01)
+    near("EEPROM bytes - no saves while driving", v["eeprom"], 0, 0)
+
+
+def idle(image):
+    rpm, width, hours = 800, 2, 0.5
+    seconds = hours * 3600
+    saves = seconds // SAVE_INTERVAL
+    print("idle - %d rpm, %d ms for %g h, then powered up again" % (rpm, width, hours))
+    v = run("-s", 0, "-r", rpm, "-w", width, "-t", hours, "-e", image)
+
+    near("VSS pulses", v["pulses"], 0, 0)
+    check("injector ticks", v["ticks"], injections(rpm, seconds - LAG) * ticks(width), injections(rpm, seconds) * ticks(width))
+    near("fuel, L", v["fuel"], litres(v["ticks"]), 0.001)
+    near("speed, km/h", v["speed"], 0, 0)
+    # 6 or 7 injections in a second
+    check("instant, L/h", v["instant"], litres(ticks(width)) * int(rpm / 120) * 3600, litres(ticks(width)) * (int(rpm / 120) + 1) * 3600)
+    check("EEPROM bytes, one record a minute", v["eeprom"], saves - 1, (saves + 1) * SLOT)
+
+    # The last record saved, at most a minute before the end
+    again = run("-s", 0, "-r", 0, "-t", 0.001, "-e", image)
+    check("injector ticks loaded", again["ticks"], v["ticks"] - injections(rpm, SAVE_INTERVAL + 1) * ticks(width), v["ticks"])
+    near("VSS pulses loaded", again["pulses"], 0, 0)
+
+
+def hold(trace):
+    speed, seconds, press, held = 50, 120, 60, 3.5
+    print("hold - FUNC held %g s on the trip screen at %d s of %d km/h for %d s" % (held, press, speed, seconds))
+
+    # NEXT twice goes from the first screen to the trip one, 3 s hold resets it
+    buttons = [(press - 2, "N 1"), (press - 1.9, "N 0"), (press - 1, "N 1"), (press - 0.9, "N 0"), (press, "F 1"), (press + held, "F 0")]
+    step = 1 / pulses(speed, 1)
+    with open(trace, "w") as f:
+        t = step
+        while t < seconds:
+            while buttons and buttons[0][0] <= t:
+                f.write("%d %s\n" % (buttons[0][0] * 1e6, buttons.pop(0)[1]))
+            f.write("%d V\n" % (t * 1e6))
+            t += step
+
+    v = run("-f", trace)
+    # Trip counts again from the reset, 3 s after the press give or take a tick and a second of counting
+    check("VSS pulses since the reset", v["pulses"], pulses(speed, seconds - press - 3 - LAG) - 1, pulses(speed, seconds - press - 3 + LAG))
+
+
+def window(trace):
+    speed, seconds, press, held = 50, 60, 20, 7
+    print("window - range window changed while FUNC is held %g s on the first screen" % held)
+
+    # NEXT with FUNC held picks the next window - holding on neither resets the averages
+    # at 3 s, which saves the trip, nor opens calibration at 6 s, which stops counting the trip
+    buttons = [(press, "F 1"), (press + 1.5, "N 1"), (press + 1.6, "N 0"), (press + held, "F 0")]
+    step = 1 / pulses(speed, 1)
+    with open(trace, "w") as f:
+        t = step
+        while t < seconds:
+            while buttons and buttons[0][0] <= t:
+                f.write("%d %s\n" % (buttons[0][0] * 1e6, buttons.pop(0)[1]))
+            f.write("%d V\n" % (t * 1e6))
+            t += step
+
+    v = run("-f", trace)
+    check("VSS pulses, all of them a trip", v["pulses"], pulses(speed, seconds - LAG) - 1, pulses(speed, seconds + LAG))
+    near("EEPROM bytes - no reset saved", v["eeprom"], 0, 0)
+
+
+def calibrate(trace, image):
+    count, ccMin, rate = 120000, 100, 500
+    print("calibrate - %d VSS pulses over 10 km on the calibration screen, then driven with what was saved" % count)
+
+    # FUNC held 7 s on the first screen opens calibration with the pulse counter, 10 km are driven,
+    # then NEXT twice goes to the pulse distance, which is saved. One NEXT more leaves it, and the
+    # pulses after that are shown as speed with the new calibration - 20% off the host default -
+    # without a power cycle
+    events = [(1, "F 1"), (8, "F 0")]
+    events += [(10 + n * 0.0002, "V") for n in range(count)]
+    events += [(45, "N 1"), (45.1, "N 0"), (45.5, "N 1"), (45.6, "N 0"), (50, "N 1"), (50.1, "N 0")]
+    events += [(60 + n / rate, "V") for n in range(30 * rate)]
+    with open(trace, "w") as f:
+        for at, what in events:
+            f.write("%d %s\n" % (at * 1e6, what))
+        f.write("%d N 0\n" % 90e6)
+
+    # Stopped while the pulses still come - a trace otherwise runs a second past its last event
+    v = run("-f", trace, "-e", image, "-t", 89.9 / 3600)
+    near("VSS pulses - none of them a trip", v["pulses"], 0, 0)
+    shown = rate * 10 / count * 3600
+    near("speed right after saving, km/h at %d pulses/s" % rate, v["shown"], shown, shown * 0.005)
+
+    speed, rpm, width, hours = 90, 2500, 3, 0.1
+    v = run("-s", speed, "-r", rpm, "-w", width, "-t", hours, "-e", image)
+    near("distance, 10 km in %d pulses" % count, v["distance"], v["pulses"] * 10 / count, v["distance"] * 1e-5 + 0.001)
+    near("fuel, L at %d cc/min" % ccMin, v["fuel"], v["ticks"] * TICK_CYCLES / F_CPU * ccMin / 60000 * INJECTORS, 0.001)
+
+
+def empty(trace, image):
+    print("empty calibration - pulse distance screen reached with no pulses counted")
+
+    # 10 km / 0 pulses isn't a distance - nothing is saved and the default calibration stays
+    events = [(1, "F 1"), (8, "F 0"), (45, "N 1"), (45.1, "N 0"), (45.5, "N 1"), (45.6, "N 0"), (50, "N 1"), (50.1, "N 0")]
+    with open(trace, "w") as f:
+        for at, what in events:
+            f.write("%d %s\n" % (at * 1e6, what))
+
+    run("-f", trace, "-e", image)
+    v = run("-s", 90, "-r", 2500, "-w", 3, "-t", 0.1, "-e", image)
+    near("distance, km at the default pulse distance", v["distance"], v["pulses"] * PULSE_DISTANCE, 0.001)
+    near("shown speed, km/h", v["shown"], 90, 0.5)
+
+
+def legacy(tmp):
+    sketch = os.path.join(os.path.dirname(__file__), "..", "sketch")
+    print("legacy - EEPROM of the first firmware converted, other layouts dropped")
+
+    # 100 km on the Polo, saved by the sketch with its own calibration
+    image = shutil.copy(os.path.join(sketch, "eeprom328-saved-polo-100km.data"), tmp)
+    for when in ("converted", "loaded again"):
+        v = run("-s", 0, "-r", 0, "-t", 0.001, "-e", image)
+        near("VSS pulses %s" % when, v["pulses"], 100.015 / 3.71016e-05, 30)
+        near("distance %s, km" % when, v["distance"], 100.015, 0.002)
+        near("fuel %s, L" % when, v["fuel"], 14.98, 0.001)
+        near("average %s, L/100km" % when, v["average"], 15.05, 0.01)
+
+    # Saved by a layout that was never released - nothing to trust
+    image = shutil.copy(os.path.join(sketch, "eeprom328-saved.data"), tmp)
+    v = run("-s", 0, "-r", 0, "-t", 0.001, "-e", image)
+    near("VSS pulses of a dropped image", v["pulses"], 0, 0)
+    near("injector ticks of a dropped image", v["ticks"], 0, 0)
+
+
+def main():
+    with tempfile.TemporaryDirectory() as tmp:
+        cruise(90, 2500, 3, 1)
+        # Shortest and longest injections - every one has to be counted to the tick
+        cruise(30, 1000, 2, 0.25)
+        cruise(130, 3500, 15, 0.25)
+        # 32 bit TIMER0 ticks wrap after 4.77 h
+        cruise(90, 2500, 3, 5, ", across the tick wrap")
+        idle(os.path.join(tmp, "idle.eeprom"))
+        hold(os.path.join(tmp, "hold.trace"))
+        window(os.path.join(tmp, "window.trace"))
+        calibrate(os.path.join(tmp, "calibrate.trace"), os.path.join(tmp, "calibrate.eeprom"))
+        empty(os.path.join(tmp, "empty.trace"), os.path.join(tmp, "empty.eeprom"))
+        legacy(tmp)
+
+    if failed:
+        print("%d checks failed" % failed)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
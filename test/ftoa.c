@@ -0,0 +1,159 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+
+// Number formatting against printf - a table of edge cases, then every small value at every
+// scale, decimals and width the screens use, and random ones over the whole range of long.
+// Values stay within 32 bits, long of the AVR
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ftoa.h"
+#include "test.h"
+
+static const struct {
+    long value;
+    uint8_t scale, decimals, width;
+    const char *text;
+} TABLE[] = {
+    {0, 0, 0, 0, "0"},
+    {0, 3, 2, 0, "0.00"},
+    {0, 3, 2, 6, "  0.00"},
+    {5, 3, 1, 0, "0.0"},
+    {50, 3, 1, 0, "0.1"},          // Half rounds away from zero
+    {-50, 3, 1, 0, "-0.1"},
+    {-49, 3, 1, 0, "0.0"},         // No "-0.0"
+    {-4, 1, 0, 4, "   0"},
+    {9995, 3, 2, 0, "10.00"},      // Carry into a new digit
+    {99950, 3, 1, 0, "100.0"},
+    {-999500, 3, 0, 0, "-1000"},
+    {-95, 2, 1, 6, "  -1.0"},
+    {12345, 3, 1, 3, "12.3"},      // Wider than `width` isn't cut
+    {7, 0, 2, 0, "7.00"},          // More decimals than the value has
+    {-7, 1, 3, 0, "-0.700"},
+    {INT32_MAX, 0, 0, 0, "2147483647"},
+    {INT32_MIN, 0, 0, 0, "-2147483648"},
+    {INT32_MIN, 9, 9, 0, "-2.147483648"},
+    {INT32_MIN, 9, 0, 12, "          -2"},
+    {INT32_MAX, 9, 8, 12, "  2.14748365"},
+    {INT32_MAX, 1, 0, 11, "  214748365"},
+};
+
+// Settings are shown with one decimal, calibration with eight - float only holds 7 digits, so these are small
+static const float SETTINGS[] = {0.0f, 0.5f, -0.5f, 0.05f, 2.5f, 12.25f, 24.0f, 99.95f, -3.14159f, 1000.04f};
+static const float CALIBRATION[] = {0.0f, 0.00006823f, 0.0000371016f, 0.0025f, 0.00258333f, 0.000000005f, 0.00999999f};
+
+static const long POW10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+
+// A value rounded to zero keeps its sign in printf, fixtoa drops it
+static void unsign(char *text, uint8_t width, char *res) {
+    char *minus = text[0] == '-' && !strpbrk(text, "123456789") ? text + 1 : text;
+    snprintf(res, 32, "%*s", width, minus);
+}
+
+// When digits are dropped, printf rounds the value nudged a tenth of its last digit away from zero,
+// so ties go the same way as in fixtoa and nothing else changes
+static void reference(long value, uint8_t scale, uint8_t decimals, uint8_t width, char *res) {
+    double nudge = (scale > decimals) ? (value < 0 ? -0.1 : 0.1) : 0;
+    char text[32];
+
+    snprintf(text, sizeof(text), "%.*f", decimals, (value + nudge) / POW10[scale]);
+    unsign(text, width, res);
+}
+
+static int same(long value, uint8_t scale, uint8_t decimals, uint8_t width, unsigned *bad) {
+    char expected[32], text[32];
+
+    reference(value, scale, decimals, width, expected);
+    fixtoa(value, scale, decimals, width, text);
+    if(!strcmp(text, expected)) return 1;
+    if(!(*bad)++) printf("       %ld scale %u decimals %u width %u: \"%s\", printf \"%s\"\n", value, scale, decimals, width, text, expected);
+    return 0;
+}
+
+
+static void table(void) {
+    char text[32], what[64];
+    uint8_t i;
+
+    testCase("table - zero, negatives, carries, widths, limits of long");
+    for(i = 0; i != sizeof(TABLE)/sizeof(TABLE[0]); ++i) {
+        fixtoa(TABLE[i].value, TABLE[i].scale, TABLE[i].decimals, TABLE[i].width, text);
+        snprintf(what, sizeof(what), "%ld/10^%u, %u decimals, width %u is \"%s\"",
+                 TABLE[i].value, TABLE[i].scale, TABLE[i].decimals, TABLE[i].width, TABLE[i].text);
+        if(!CHECK(what, !strcmp(text, TABLE[i].text))) printf("       got \"%s\"\n", text);
+    }
+}
+
+static void sweep(void) {
+    unsigned bad = 0, n;
+    uint32_t seed = 1;
+    long value;
+    uint8_t scale, decimals, width;
+
+    testCase("sweep - same as printf");
+    for(scale = 0; scale <= 3; ++scale)
+        for(decimals = 0; decimals <= 3; ++decimals)
+            for(width = 0; width <= 8; width += 8)
+                for(value = -20000; value <= 20000; ++value) same(value, scale, decimals, width, &bad);
+    CHECK_NEAR("-20000 to 20000, scales and decimals 0-3", bad, 0, 0);
+
+    // Decimals up to the scale, more would overflow the long
+    bad = 0;
+    for(n = 0; n != 1000000; ++n) {
+        seed = seed*1664525 + 1013904223;
+        value = (int32_t)seed;
+        scale = n % 10;
+        same(value, scale, n/10 % (scale + 1), 12, &bad);
+    }
+    CHECK_NEAR("random longs, scales 0-9", bad, 0, 0);
+}
+
+static unsigned floats(const float *values, uint8_t count, uint8_t decimals) {
+    char text[32], printed[32], expected[32];
+    unsigned bad = 0;
+    uint8_t i;
+
+    // Nudged by a thousandth of the last digit - a float tie is exact, printf would round it to even
+    for(i = 0; i != count; ++i) {
+        ftoa(values[i], text, decimals);
+        snprintf(printed, sizeof(printed), "%.*f", decimals, values[i] + (values[i] < 0 ? -0.001 : 0.001) / POW10[decimals]);
+        unsign(printed, 0, expected);
+        if(strcmp(text, expected) && !bad++) printf("       %g: \"%s\", printf \"%s\"\n", values[i], text, expected);
+    }
+    return bad;
+}
+
+static void settings(void) {
+    testCase("ftoa - floats the settings screens show");
+    CHECK_NEAR("settings, 1 decimal", floats(SETTINGS, sizeof(SETTINGS)/sizeof(SETTINGS[0]), 1), 0, 0);
+    CHECK_NEAR("calibration, 8 decimals", floats(CALIBRATION, sizeof(CALIBRATION)/sizeof(CALIBRATION[0]), 8), 0, 0);
+}
+
+
+int main(void) {
+    table();
+    sweep();
+    settings();
+    return testEnd();
+}
@@ -0,0 +1,176 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+
+// SPI transport of the PCD8544 driver - every byte the SPI unit shifts out goes into a model of the
+// controller RAM, so the glass can be compared with what was drawn
+
+#include <stdio.h>
+#include <string.h>
+
+#include <avr/io.h>
+
+#include "display.h"
+#include "host.h"
+#include "test.h"
+
+#define BYTES (LCD_BANKS*LCD_WIDTH)
+
+static uint8_t glass[BYTES], frame[BYTES];
+static uint8_t glassX, glassBank;
+static unsigned commands, data, deselected;
+
+
+// Takes every byte the SPI unit shifts out the way the controller does - address commands move the
+// pointer, data goes to RAM
+static void shift(uint8_t byte) {
+    if(PORTB & (1<<LCD_SCE)) ++deselected;
+    if(PORTB & (1<<LCD_DC)) {
+        glass[glassBank*LCD_WIDTH + glassX] = byte;
+        if(++glassX == LCD_WIDTH) {
+            glassX = 0;
+            if(++glassBank == LCD_BANKS) glassBank = 0;
+        }
+        ++data;
+        return;
+    }
+
+    if(byte & 0x80) glassX = byte & 0x7F;
+    else if((byte & 0xF8) == 0x40) glassBank = byte & 0x07;
+    ++commands;
+}
+
+// Completes bytes until the driver turns the interrupt off, returns the interrupts taken
+static unsigned drain(unsigned most) {
+    unsigned n = 0;
+
+    while((SPCR & (1<<SPIE)) && n != most && hostSpiComplete()) ++n;
+    return n;
+}
+
+static void clearCounts(void) {commands = data = deselected = 0;}
+
+// Writes a whole byte through the column API and into the expected frame
+static void put(uint8_t x, uint8_t bank, uint8_t value) {
+    screenLCDColumn(x, bank*8, value, 8);
+    frame[bank*LCD_WIDTH + x] = value;
+}
+
+
+static void init(void) {
+    testCase("init - reset pin and cycle clock");
+    hostSpiByte = shift;
+    screenLCDInit();
+
+    CHECK("RST is an output of PORTC", DDRC & (1<<PC0));
+    CHECK("RST released after the reset pulse", PORTC & (1<<PC0));
+    CHECK("MISO left alone", !(DDRB & (1<<PB4)) && !(PORTB & (1<<PB4)));
+    CHECK("SPI master enabled", (SPCR & (1<<SPE)) && (SPCR & (1<<MSTR)));
+    CHECK("TIMER2 counts every cycle", TCCR2B == (1<<CS20));
+    CHECK_NEAR("RAM cleared by the init sequence, data bytes", data, BYTES, 0);
+    CHECK("init leaves SPIF set, as the chip does", SPSR & (1<<SPIF));
+}
+
+static void fullFrame(void) {
+    static uint8_t bitmap[BYTES];
+    unsigned i, interrupts, seed = 1;
+
+    testCase("full frame - new background, every byte shifted out once");
+    for(i = 0; i != BYTES; ++i) {
+        seed = seed*1103515245 + 12345;
+        bitmap[i] = frame[i] = seed >> 16;
+    }
+    screenLCDBackground(bitmap);
+
+    clearCounts();
+    hostReadCycles = 3;
+    CHECK("swap accepted", screenLCDSwap());
+    interrupts = drain(-1);
+
+    CHECK("glass matches the frame", !memcmp(glass, frame, BYTES));
+    CHECK_NEAR("data bytes", data, BYTES, 0);
+    CHECK_NEAR("address commands, two per bank", commands, 2*LCD_BANKS, 0);
+    CHECK_NEAR("interrupts, one per byte", interrupts, BYTES + 2*LCD_BANKS, 0);
+    CHECK_NEAR("bytes shifted with CS high", deselected, 0, 0);
+    CHECK_NEAR("SPDR written during a transfer", hostSpiCollisions, 0, 0);
+    CHECK("CS high at the end", PORTB & (1<<LCD_SCE));
+
+    // Every measured span reads the clock twice, so it's one step long - interrupts, copy chunks and the first byte
+    CHECK("nothing left to send", screenLCDSwap() && !(SPCR & (1<<SPIE)));
+    CHECK_NEAR("bytes reported", screenLCDSent(), BYTES, 0);
+    CHECK_NEAR("cycles reported", screenLCDCycles(),
+               hostReadCycles * (interrupts + 1 + LCD_BANKS*((LCD_WIDTH + LCD_COPY_CHUNK-1) / LCD_COPY_CHUNK)), 0);
+    hostReadCycles = 0;
+}
+
+static void partial(void) {
+    testCase("partial frame - only changed spans");
+    put(10, 2, ~frame[2*LCD_WIDTH + 10]);
+    put(12, 2, ~frame[2*LCD_WIDTH + 12]);
+    put(50, 5, ~frame[5*LCD_WIDTH + 50]);
+    put(30, 1, frame[1*LCD_WIDTH + 30]);  // Same as the glass, not dirty
+
+    clearCounts();
+    CHECK("swap accepted", screenLCDSwap());
+    drain(-1);
+
+    CHECK("glass matches the frame", !memcmp(glass, frame, BYTES));
+    CHECK_NEAR("data bytes, span 10-12 and 50", data, 4, 0);
+    CHECK_NEAR("address commands", commands, 4, 0);
+
+    clearCounts();
+    put(20, 0, frame[20]);
+    CHECK("unchanged frame starts no transfer", screenLCDSwap() && !(SPCR & (1<<SPIE)) && !data && !commands);
+}
+
+static void doubleBuffer(void) {
+    uint8_t shown[BYTES];
+
+    testCase("double buffer - drawing while the previous frame is sent");
+    put(0, 0, ~frame[0]);
+    put(83, 0, ~frame[83]);
+    memcpy(shown, frame, BYTES);
+
+    clearCounts();
+    CHECK("swap accepted", screenLCDSwap());
+    drain(20);
+
+    put(40, 0, ~frame[40]);  // Inside the span being sent
+    put(5, 4, ~frame[4*LCD_WIDTH + 5]);
+    CHECK("swap refused while sending", !screenLCDSwap());
+    drain(-1);
+
+    CHECK("glass shows the frame of the swap", !memcmp(glass, shown, BYTES));
+    CHECK_NEAR("data bytes, span 0-83", data, LCD_WIDTH, 0);
+
+    CHECK("next swap accepted", screenLCDSwap());
+    drain(-1);
+    CHECK("glass shows the new frame", !memcmp(glass, frame, BYTES));
+    CHECK_NEAR("SPDR written during a transfer", hostSpiCollisions, 0, 0);
+}
+
+
+int main(void) {
+    init();
+    fullFrame();
+    partial();
+    doubleBuffer();
+    return testEnd();
+}
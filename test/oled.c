@@ -0,0 +1,148 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+
+// SSD1327 strip renderer - every screen layer with text on top is put together from the strips
+// `oledRender()` draws and compared with a golden image in `test/golden/`. After a deliberate change:
+//   ./build/test/oled --update
+
+#include <stdio.h>
+#include <string.h>
+
+#include "display.h"
+#include "screens.h"
+#include "test.h"
+
+#define GOLDEN "test/golden/"
+#define PIXELS (SSD1327_WIDTH*SSD1327_HEIGTH)
+
+static const struct {
+    const char *name;
+    const uint8_t *layer;
+} SCENES[] = {
+    {"fuel", SCREEN_FUEL},
+    {"speed", SCREEN_SPEED},
+    {"main", SCREEN_MAIN},
+    {"acceleration", SCREEN_ACCELERATION},
+    {"sailing", SCREEN_SAILING},
+};
+
+static const uint8_t *layer;
+static uint8_t image[PIXELS];
+static uint8_t strip;
+
+
+// Scene of one screen - its layer, white text across the strip boundary at row 16 and gray text across the one at 112
+static void scene(void) {
+    displayBackground(layer);
+    displayCursor(2, 12);
+    displayText2("88.8");
+    oledWriteString(0, 100, "GRAY", 3, 0x07);
+}
+
+// Called once per strip by the renderer, keeps what the strip came out as
+static void capture(void) {
+    uint16_t row, column;
+
+    scene();
+    for(row = 0; row != OLED_STRIP_ROWS; ++row)
+        for(column = 0; column != SSD1327_WIDTH; ++column) {
+            uint8_t pixels = ssd1327_buf[row*(SSD1327_WIDTH/2) + column/2];
+            image[(strip*OLED_STRIP_ROWS + row)*SSD1327_WIDTH + column] = (column & 1) ? pixels & 0x0F : pixels >> 4;
+        }
+    ++strip;
+}
+
+static void render(void) {
+    strip = 0;
+    oledRender(capture);
+}
+
+
+static int golden(const char *name, uint8_t update) {
+    static uint8_t expected[PIXELS];
+    char path[64];
+    FILE *f;
+    int width, height, levels, ok;
+
+    snprintf(path, sizeof(path), GOLDEN "%s.pgm", name);
+    if(update) {
+        f = fopen(path, "wb");
+        if(!f) return 0;
+        fprintf(f, "P5\n%d %d\n15\n", SSD1327_WIDTH, SSD1327_HEIGTH);
+        ok = fwrite(image, 1, PIXELS, f) == PIXELS;
+        fclose(f);
+        return ok;
+    }
+
+    f = fopen(path, "rb");
+    if(!f) return 0;
+    ok = fscanf(f, "P5 %d %d %d", &width, &height, &levels) == 3 && fgetc(f) != EOF
+         && width == SSD1327_WIDTH && height == SSD1327_HEIGTH && levels == 15
+         && fread(expected, 1, PIXELS, f) == PIXELS && !memcmp(image, expected, PIXELS);
+    fclose(f);
+    return ok;
+}
+
+static void scenes(uint8_t update) {
+    char what[48];
+    uint8_t i;
+
+    testCase(update ? "scenes - saving golden images" : "scenes - strips put together against golden images");
+    for(i = 0; i != sizeof(SCENES)/sizeof(SCENES[0]); ++i) {
+        layer = SCENES[i].layer;
+        render();
+        snprintf(what, sizeof(what), "%s" GOLDEN "%s.pgm", update ? "saved " : "", SCENES[i].name);
+        CHECK(what, strip == SSD1327_HEIGTH/OLED_STRIP_ROWS && golden(SCENES[i].name, update));
+    }
+}
+
+static void transfer(void) {
+    testCase("transfer - only blocks that were marked");
+    layer = SCREEN_MAIN;
+    oledInvalidate();
+    render();
+    CHECK_NEAR("full frame after invalidate", oledSent(), PIXELS/2, 0);
+    render();
+    CHECK_NEAR("same frame again", oledSent(), 0, 0);
+    layer = SCREEN_SPEED;
+    render();
+    CHECK_NEAR("another layer, nothing marked", oledSent(), 0, 0);
+    oledMark(0, 0, SSD1327_WIDTH, 48);
+    render();
+    CHECK_NEAR("another layer, top 48 rows", oledSent(), 48*SSD1327_WIDTH/2, 0);
+    // 50x14 at (6, 7) spans the first two blocks of the first two strips
+    oledMark(6, 7, 50, 14);
+    render();
+    CHECK_NEAR("one field", oledSent(), 2*OLED_STRIP_ROWS*2*OLED_BLOCK_COLUMNS, 0);
+    oledMark(200, 200, 10, 10);
+    render();
+    CHECK_NEAR("off the screen", oledSent(), 0, 0);
+}
+
+
+int main(int argc, char **argv) {
+    uint8_t update = argc > 1 && !strcmp(argv[1], "--update");
+
+    oledInit(SSD1327_SWITCHCAPVCC, REFRESH_MID);
+    scenes(update);
+    if(!update) transfer();
+    return testEnd();
+}
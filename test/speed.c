@@ -0,0 +1,200 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+
+// VSS edges fed to speed.c against TIMER0 of the simulated chip, a main loop calling `speedUpdate()`
+// every millisecond - constant speeds from 1 to 250 km/h, a ramp up to 250 km/h and down again, which
+// has to switch to counting and back once each near the edge rates of speed.h, and a sudden stop,
+// which has to be shown as standing 2 s after the last edge
+
+#include <math.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <avr/io.h>
+
+#include "host.h"
+#include "speed.h"
+#include "test.h"
+
+#define PULSE_DISTANCE 0.00006823     // km per VSS pulse - host default calibration
+#define STEP (F_CPU / 1000)           // Cycles between two passes of the main loop
+#define STEP_S (1.0 / 1000)
+#define KMH(rate) ((rate) * PULSE_DISTANCE * 3600)   // Speed of an edge rate
+#define ACCEL 2.5                     // km/h per second on the ramp
+#define COUNT_ON 400                  // Edges per second counting has to start at - about 98 km/h here
+#define COUNT_OFF 320                 // ... and stop at, about 79 km/h
+#define TIMEOUT_S 2.0                 // s without an edge that make standing
+#define LAG (SPEED_GATES / (double)SPEED_HZ)          // s the counted edges reach back
+
+void TIMER0_OVF_vect(void);
+
+typedef void (*watcher)(double kmh);
+
+static double pulses = 0;             // Share of the next pulse driven already
+static uint64_t lastEdge = 0;         // Cycles
+
+
+// Moves the simulated time on, TIMER0 overflows included
+static void advance(uint64_t to) {
+    while(hostT0Next <= to) {
+        hostNow = hostT0Next;
+        hostT0Next += OVERFLOW_CYCLES;
+        TIFR0 &= ~(1<<TOV0);
+        TIMER0_OVF_vect();
+    }
+    hostNow = to;
+}
+
+// `seconds` going from `from` to `to` km/h evenly, edges at the exact time they fall on
+static void drive(double from, double to, double seconds, watcher watch) {
+    uint32_t n, steps = seconds / STEP_S + 0.5;
+    uint64_t start;
+    double kmh, dp, k;
+
+    for(n = 0; n != steps; ++n) {
+        kmh = from + (to - from) * (n + 0.5) / steps;
+        dp = kmh / 3600 * STEP_S / PULSE_DISTANCE;
+        start = hostNow;
+
+        for(k = 1; k <= pulses + dp; ++k) {
+            lastEdge = start + (uint64_t)((k - pulses) / dp * STEP);
+            advance(lastEdge);
+            speedEdge();
+        }
+        pulses = pulses + dp - (k - 1);
+
+        advance(start + STEP);
+        speedUpdate();
+        if(watch) watch(kmh);
+    }
+}
+
+static void start(void) {
+    TCCR0B = (1<<CS01) | (1<<CS00);   // Prescaler 64 as `main()` sets it
+    hostT0Next = OVERFLOW_CYCLES;
+    speedCalibrate(PULSE_DISTANCE);
+}
+
+
+static double worst, switchedOn, switchedOff;
+static unsigned switches;
+static uint8_t counting;
+
+static void switchPoints(double kmh) {
+    double off = fabs(speedNow.speed / 10.0 - kmh);
+
+    if(off > worst) worst = off;
+    if(speedNow.counting == counting) return;
+    counting = speedNow.counting;
+    ++switches;
+    if(counting) switchedOn = kmh;
+    else switchedOff = kmh;
+}
+
+// Settled for 5 s, then every update of 5 s more within half a percent - 0.1 km/h is all it keeps.
+// Right at the edge rates it may count or not, but must not go back and forth
+static void constant(double kmh) {
+    char what[64];
+
+    drive(kmh, kmh, 5, NULL);
+    worst = 0;
+    counting = speedNow.counting;
+    drive(kmh, kmh, 5, switchPoints);
+
+    snprintf(what, sizeof(what), "%g km/h, worst off (%s)", kmh, speedNow.counting ? "counted" : "edge periods");
+    CHECK_RANGE(what, worst, 0, kmh * 0.005 + 0.1);
+    snprintf(what, sizeof(what), "%g km/h, switches once settled", kmh);
+    CHECK_NEAR(what, switches, 0, 0);
+}
+
+// Counting starts once the edges of the last gates reach the rate - the car is a little faster by then
+static void ramp(void) {
+    worst = 0;
+    drive(0, 250, 250 / ACCEL, switchPoints);
+    drive(250, 0, 250 / ACCEL, switchPoints);
+
+    CHECK_RANGE("counting from, km/h", switchedOn, KMH(COUNT_ON), KMH(COUNT_ON) + ACCEL * LAG);
+    CHECK_RANGE("edge periods from, km/h", switchedOff, KMH(COUNT_OFF) - ACCEL * LAG, KMH(COUNT_OFF));
+    CHECK_NEAR("switches", switches, 2, 0);
+    CHECK_RANGE("worst off while speeding up and slowing down, km/h", worst, 0, ACCEL * LAG + 250 * 0.005);
+}
+
+
+static uint64_t standing;
+
+static void stopWatch(double kmh) {
+    if(!standing && speedNow.stopped) standing = hostNow;
+}
+
+// Edges stop at once - the speed has to fall with the time since the last one, and be standing after 2 s
+static void stop(void) {
+    drive(20, 20, 5, NULL);
+    drive(0, 0, 1, NULL);
+    CHECK_RANGE("1 s after the last edge, km/h", speedNow.speed / 10.0, 0, KMH(1.0));
+    CHECK("not standing yet", !speedNow.stopped);
+
+    drive(0, 0, 2, stopWatch);
+    CHECK_RANGE("standing after the last edge, s", (double)(standing - lastEdge) / F_CPU, TIMEOUT_S, TIMEOUT_S + 1.0 / SPEED_HZ);
+    CHECK_NEAR("standing, km/h", speedNow.speed, 0, 0);
+}
+
+
+int main(void) {
+    static const double SPEEDS[] = {1, 2, 5, 10, 20, 30, 50, 70, 90, 98, 100, 110, 130, 160, 200, 250};
+    int status, failed = 0;
+    uint8_t i;
+
+    // speed.c starts over at power up only - every case gets a process of its own
+    testCase("constant speeds");
+    for(i = 0; i != sizeof(SPEEDS)/sizeof(SPEEDS[0]); ++i) {
+        fflush(stdout);
+        if(!fork()) {
+            start();
+            constant(SPEEDS[i]);
+            return testEnd();
+        }
+        wait(&status);
+        failed |= !WIFEXITED(status) || WEXITSTATUS(status);
+    }
+
+    fflush(stdout);
+    if(!fork()) {
+        testCase("ramp - 0 to 250 km/h and back at 2.5 km/h a second");
+        start();
+        ramp();
+        return testEnd();
+    }
+    wait(&status);
+    failed |= !WIFEXITED(status) || WEXITSTATUS(status);
+
+    fflush(stdout);
+    if(!fork()) {
+        testCase("stop - edges end at 20 km/h");
+        start();
+        stop();
+        return testEnd();
+    }
+    wait(&status);
+    failed |= !WIFEXITED(status) || WEXITSTATUS(status);
+
+    return failed;
+}
@@ -0,0 +1,158 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+
+// Trip record ring against the simulated EEPROM - records go round every slot evenly, the newest one
+// is always found, also across the 16 bit sequence wrap, and a record cut short by a power loss or
+// with a flipped bit is rejected by its CRC in favour of the one before. The EE_READY interrupt is
+// run by hand, one byte at a time, so a write can stop anywhere
+
+#include <stdio.h>
+#include <string.h>
+
+#include "store.h"
+#include "persist.h"
+#include "host.h"
+#include "test.h"
+
+void EE_READY_vect(void);
+
+static uint16_t slotBytes;
+
+
+// Programs the next `bytes` bytes the queue holds, everything with -1
+static void program(long bytes) {
+    while(bytes-- && persistBusy()) {
+        EE_READY_vect();
+        hostEepromSync();
+    }
+}
+
+// Different in every field, so every save changes most bytes of its slot
+static void record(storeRecord *r, uint32_t n) {
+    memset(r, 0, sizeof(storeRecord));
+    r->trip.pulses = n * 1297ULL;
+    r->trip.sailingPulses = n * 13ULL;
+    r->trip.fuelTicks = n * 65537ULL;
+    r->trip.speedInvSum = (uint64_t)n << 28;
+    r->trip.avgFuelTicks = n * 401ULL;
+    r->trip.speedSamples = n;
+    r->trip.avgPulses = n * 7;
+    r->savedFuel = -(long)n;
+}
+
+static int loads(uint32_t n) {
+    storeRecord expected, loaded;
+
+    record(&expected, n);
+    return storeLoad(&loaded) && !memcmp(&loaded, &expected, sizeof(storeRecord));
+}
+
+static void save(uint32_t n) {
+    storeRecord r;
+
+    record(&r, n);
+    storeSave(&r);
+    program(-1);
+}
+
+
+static void empty(void) {
+    storeRecord r;
+
+    testCase("erased EEPROM");
+    memset(hostEeprom(), 0xFF, hostEepromSize());
+    CHECK("nothing loaded", !storeLoad(&r));
+}
+
+static void rotation(void) {
+    uint32_t saves = 70000, n, worst = 0, least = ~0UL, total = 0;
+    unsigned bad = 0, i;
+
+    testCase("rotation - 70000 saves, every one loaded back, past the sequence wrap");
+    memset(hostEeprom(), 0xFF, hostEepromSize());
+    memset(hostEeWear, 0, sizeof(hostEeWear));
+    storeLoad(&(storeRecord){0});
+
+    for(n = 1; n <= saves; ++n) {
+        save(n);
+        if(!loads(n) && !bad++) printf("       save %lu not loaded\n", (unsigned long)n);
+    }
+    CHECK_NEAR("saves not loaded back", bad, 0, 0);
+
+    // The sequence number at the start of a slot changes with every save into it
+    for(i = 0; i != hostEepromSize(); ++i) {
+        if(hostEeWear[i] > worst) worst = hostEeWear[i];
+        if(i % slotBytes == 0 && hostEeWear[i] < least) least = hostEeWear[i];
+        total += hostEeWear[i];
+    }
+    CHECK_RANGE("most programmed cell", worst, 1, (saves + STORE_SLOTS - 1) / STORE_SLOTS);
+    CHECK_RANGE("least saves into a slot", least, saves / STORE_SLOTS, saves / STORE_SLOTS + 1);
+    CHECK_NEAR("cells programmed, per cell and all", total, hostEeWrites, 0);
+}
+
+static void torn(void) {
+    storeRecord r;
+    unsigned previous = 0, cut;
+
+    testCase("torn records - power lost after every byte of a save");
+    for(cut = 0; cut != slotBytes; ++cut) {
+        save(100000 + 2*cut);
+        record(&r, 100001 + 2*cut);
+        storeSave(&r);
+        program(cut);
+        previous += loads(100000 + 2*cut);
+
+        // Powered up again - the rest of the record, as storeLoad() would place it anyway
+        program(-1);
+    }
+    CHECK_NEAR("cuts with the previous record loaded", previous, slotBytes, 0);
+    CHECK("finished record loaded", loads(100001 + 2*(slotBytes - 1)));
+}
+
+static void flipped(void) {
+    uint8_t *cell = hostEeprom();
+    unsigned newest = 0, previous = 0, i, bit;
+
+    testCase("flipped bits - every bit of the ring, one at a time");
+    save(200000);
+    save(200001);
+    for(i = 0; i != hostEepromSize(); ++i) {
+        for(bit = 0; bit != 8; ++bit) {
+            cell[i] ^= 1<<bit;
+            if(loads(200001)) ++newest;
+            else if(loads(200000)) ++previous;
+            cell[i] ^= 1<<bit;
+        }
+    }
+    CHECK_NEAR("bits outside the newest record, newest loaded", newest, (hostEepromSize() - slotBytes) * 8, 0);
+    CHECK_NEAR("bits inside it, the one before loaded", previous, slotBytes * 8, 0);
+}
+
+
+int main(void) {
+    slotBytes = hostEepromSize() / STORE_SLOTS;
+
+    empty();
+    rotation();
+    torn();
+    flipped();
+    return testEnd();
+}
@@ -0,0 +1,48 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+
+#include <stdio.h>
+
+#include "test.h"
+
+static unsigned failed = 0;
+
+
+void testCase(const char *name) {printf("%s\n", name);}
+
+int testCheck(const char *what, int ok) {
+    if(!ok) ++failed;
+    printf("  %-4s %s\n", ok ? "ok" : "FAIL", what);
+    return ok;
+}
+
+int testRange(const char *what, double value, double low, double high) {
+    int ok = low <= value && value <= high;
+
+    if(!ok) ++failed;
+    printf("  %-4s %-40s %.6g (%.6g - %.6g)\n", ok ? "ok" : "FAIL", what, value, low, high);
+    return ok;
+}
+
+int testEnd(void) {
+    if(failed) printf("%u checks failed\n", failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,36 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+
+#ifndef TEST_H
+#define TEST_H
+
+// Checks shared by the host tests in `test/`, built against the simulated chip by `make test`.
+// Every check prints one line, failed ones make the test exit with 1
+#define CHECK(what, cond) testCheck((what), (cond))
+#define CHECK_NEAR(what, value, expected, tolerance) testRange((what), (value), (expected) - (tolerance), (expected) + (tolerance))
+#define CHECK_RANGE(what, value, low, high) testRange((what), (value), (low), (high))
+
+void testCase(const char *name);
+int  testCheck(const char *what, int ok);
+int  testRange(const char *what, double value, double low, double high);
+int  testEnd(void);  // Number of failed checks as the exit status
+
+#endif  // TEST_H
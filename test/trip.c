@@ -0,0 +1,265 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+
+// Integer trip computation against the same drive worked out in doubles - long synthetic drives of
+// stop and go, motorway and everything in between, fed tick by tick. Every value the screens show
+// is compared after every tick, the worst difference of each has to stay within what the integer
+// scale factors can lose
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "trip.h"
+#include "test.h"
+
+#define PULSE_DISTANCE 0.0000371016   // km per VSS pulse - the Polo of `sketch/`
+#define INJECTION      0.00258333     // L/s through one injector
+#define INJECTORS      4
+#define TICK_S         (1.0 / TRIP_TICKS_PER_SECOND)
+#define INJECTOR_TICK_S (TRIP_TICK_CYCLES / (double)F_CPU)
+
+#define SCALE_ERROR 2e-5              // Relative, nm per pulse and pL per tick are rounded
+#define SEGMENTS 1200                 // 100 m segments the reference remembers - the 100 km window and a 10 km block more
+
+typedef struct {
+    const char *name;
+    double hours;
+    double low, high;                 // km/h the drive picks its targets from
+    double shortest, longest;         // s a target is held
+    double stops;                     // Share of targets that are a standstill
+} drive;
+
+// Reference, in km, L and s
+static struct {
+    double km, sailingKm, litres;
+    double invSum;                    // Harmonic mean of the integer speeds the firmware shows
+    unsigned long samples;
+    unsigned long drained;            // mL handed back by `tripUpdate()`
+
+    double burnt[SEGMENTS];           // L burnt by the end of every finished 100 m segment, a ring
+    unsigned long finished;           // Segments finished since the start
+    double segmentKm, segmentLitres;  // Current segment
+
+    double minuteKm[TRIP_MINUTES], minuteLitres[TRIP_MINUTES];
+    uint8_t minute;
+    unsigned ticks;
+} ref;
+
+// Worst difference of every value
+static struct {
+    double speed, instant, avgSpeed, avgFuel, windows[TRIP_WINDOWS];
+} worst;
+
+static uint32_t seed = 1;
+
+
+static double uniform(double low, double high) {
+    seed = seed*1664525 + 1013904223;
+    return low + (high - low) * (seed >> 8) / (double)(1UL<<24);
+}
+
+// Scale factors of `trip.c` are whole nm and pL - they may be off by that much more
+static void worse(double *max, double value, double expected) {
+    double off = fabs(value - expected) - fabs(expected) * SCALE_ERROR;
+    if(off > *max) *max = off;
+}
+
+// What `consumption()` shows - nothing for less than a metre, and no more than 16 bits
+static double shown(double litres, double km) {
+    return (km < 0.001) ? 0 : fmin(litres / km * 10000, 0xFFFF);
+}
+
+// L burnt by the end of the `n`th segment
+static double burnt(unsigned long n) {return n ? ref.burnt[(n - 1) % SEGMENTS] : 0;}
+
+// Finished segments as the rings of `trip.c` keep them - each ring only gets whole turns of the one before,
+// so a window ends with the last whole block of its size
+static double windowReference(uint8_t window) {
+    unsigned long blocks, count;
+    unsigned size = 1;
+    uint8_t i;
+    double km = 0, litres = 0;
+
+    switch(window) {
+        case TRIP_WINDOW_1KM:
+        case TRIP_WINDOW_10KM:
+        case TRIP_WINDOW_100KM:
+            for(i = TRIP_WINDOW_1KM; i != window; ++i) size *= TRIP_SEGMENTS;
+            blocks = ref.finished / size;
+            count = (blocks < TRIP_SEGMENTS) ? blocks : TRIP_SEGMENTS;
+            if(!count) return 0;
+            return shown(burnt(blocks * size) - burnt((blocks - count) * size), count * size * 0.1);
+
+        case TRIP_WINDOW_5MIN:
+            for(i = 0; i != TRIP_MINUTES; ++i) {
+                km += ref.minuteKm[i];
+                litres += ref.minuteLitres[i];
+            }
+            return (km < 0.1) ? 0 : shown(litres, km);
+
+        default: return shown(ref.litres, ref.km);
+    }
+}
+
+static void referenceUpdate(uint16_t pulses, uint32_t injTicks, uint8_t elapsed, uint8_t shown) {
+    double km = pulses * PULSE_DISTANCE;
+    double litres = injTicks * INJECTOR_TICK_S * INJECTION * INJECTORS;
+    double left, share;
+
+    // Segments end where `trip.c` ends them, in its own whole µm - it drifts away from the exact distance
+    // by the rounding checked at the end, and a segment more or less would be a different window
+    left = floor(pulses * (double)tripMetres(1000000000) / 1000) / 1e9;
+
+    ref.km += km;
+    ref.litres += litres;
+    if(!injTicks) ref.sailingKm += km;
+    if(shown > 5) {
+        ref.invSum += 1.0 / shown;
+        ++ref.samples;
+    }
+
+    // Fuel split between segments by distance
+    while(ref.segmentKm + left >= 0.1) {
+        share = litres * (0.1 - ref.segmentKm) / left;
+        left -= 0.1 - ref.segmentKm;
+        litres -= share;
+        ref.burnt[ref.finished % SEGMENTS] = burnt(ref.finished) + ref.segmentLitres + share;
+        ++ref.finished;
+        ref.segmentKm = 0;
+        ref.segmentLitres = 0;
+    }
+    ref.segmentKm += left;
+    ref.segmentLitres += litres;
+
+    ref.minuteKm[ref.minute] += km;
+    ref.minuteLitres[ref.minute] += injTicks * INJECTOR_TICK_S * INJECTION * INJECTORS;
+    ref.ticks += elapsed;
+    if(ref.ticks < 60 * TRIP_TICKS_PER_SECOND) return;
+    ref.ticks -= 60 * TRIP_TICKS_PER_SECOND;
+
+    ref.minute = (ref.minute + 1) % TRIP_MINUTES;
+    ref.minuteKm[ref.minute] = 0;
+    ref.minuteLitres[ref.minute] = 0;
+}
+
+static void compare(uint16_t pulses, uint32_t injTicks, uint8_t elapsed) {
+    double seconds = elapsed * TICK_S;
+    double speed = pulses * PULSE_DISTANCE / seconds * 3600;
+    double litres = injTicks * INJECTOR_TICK_S * INJECTION * INJECTORS;
+    uint8_t i;
+
+    worse(&worst.speed, tripNow.speed, floor(speed));
+    if(tripNow.speed > 5) worse(&worst.instant, tripNow.instantFuel, fmin(litres / (pulses * PULSE_DISTANCE) * 10000, 0xFFFF));
+    else worse(&worst.instant, tripNow.instantFuel, fmin(litres / seconds * 3600 * 100, 0xFFFF));
+
+    if(ref.samples) worse(&worst.avgSpeed, tripNow.avgSpeed, ref.samples / ref.invSum);
+    worse(&worst.avgFuel, tripNow.avgFuel, windowReference(TRIP_WINDOW_TRIP));
+
+    for(i = 0; i != TRIP_WINDOWS; ++i) worse(&worst.windows[i], tripWindow(i), windowReference(i));
+}
+
+static void run(const drive *d) {
+    double speed = 0, target = 0, hold = 0, rpm, width, pulses = 0, injections = 0;
+    double accel, seconds = 0;
+    uint32_t injTicks;
+    uint16_t count;
+    uint8_t elapsed;
+    char what[64];
+
+    memset(&trip, 0, sizeof(trip));
+    memset(&ref, 0, sizeof(ref));
+    memset(&worst, 0, sizeof(worst));
+    tripCalibrate(PULSE_DISTANCE, INJECTION, INJECTORS);
+
+    testCase(d->name);
+    while(seconds < d->hours * 3600) {
+        if((hold -= TICK_S) <= 0) {
+            target = (uniform(0, 1) < d->stops) ? 0 : uniform(d->low, d->high);
+            hold = uniform(d->shortest, d->longest);
+        }
+
+        // Up to 3 km/h a second, injectors closed while slowing down on the engine
+        accel = fmax(fmin(target - speed, 0.75), -0.75);
+        speed += accel;
+        rpm = (speed < 5) ? 850 : 1200 + speed * 25;
+        width = (accel < -0.1) ? 0 : uniform(2, 4) + accel * 12;
+
+        // A late main loop hands over two ticks at once now and then
+        elapsed = (uniform(0, 1) < 0.02) ? 2 : 1;
+        seconds += elapsed * TICK_S;
+
+        pulses += speed / 3600 * elapsed * TICK_S / PULSE_DISTANCE;
+        count = pulses;
+        pulses -= count;
+        injections += rpm / 120 * elapsed * TICK_S;
+        injTicks = (uint32_t)injections * (uint32_t)(width / 1000 / INJECTOR_TICK_S);
+        injections -= (uint32_t)injections;
+
+        ref.drained += tripUpdate(count, injTicks, elapsed);
+        referenceUpdate(count, injTicks, elapsed, tripNow.speed);
+        compare(count, injTicks, elapsed);
+    }
+
+    snprintf(what, sizeof(what), "distance, km of %.0f", ref.km);
+    CHECK_NEAR(what, tripDistance() / 1000.0, ref.km, ref.km * SCALE_ERROR + 0.001);
+    CHECK_NEAR("sailing distance, km", tripSailingDistance() / 1000.0, ref.sailingKm, ref.sailingKm * SCALE_ERROR + 0.001);
+    snprintf(what, sizeof(what), "fuel, L of %.1f", ref.litres);
+    CHECK_NEAR(what, tripFuel() / 1000.0, ref.litres, ref.litres * SCALE_ERROR + 0.001);
+    CHECK_NEAR("fuel taken from the tank, L", ref.drained / 1000.0, ref.litres, ref.litres * SCALE_ERROR + 0.001);
+
+    // Worst over every tick - everything shown is truncated, so up to 1 of the last digit
+    CHECK_RANGE("worst speed, km/h", worst.speed, 0, 1);
+    CHECK_RANGE("worst instant, 0.01 L", worst.instant, 0, 1);
+    CHECK_RANGE("worst average speed, km/h", worst.avgSpeed, 0, 1);
+    CHECK_RANGE("worst average, 0.01 L/100km", worst.avgFuel, 0, 1);
+    CHECK_RANGE("worst trip window, 0.01 L/100km", worst.windows[TRIP_WINDOW_TRIP], 0, 1);
+    CHECK_RANGE("worst 1 km window, 0.01 L/100km", worst.windows[TRIP_WINDOW_1KM], 0, 1);
+    CHECK_RANGE("worst 10 km window, 0.01 L/100km", worst.windows[TRIP_WINDOW_10KM], 0, 1);
+    CHECK_RANGE("worst 100 km window, 0.01 L/100km", worst.windows[TRIP_WINDOW_100KM], 0, 1);
+    CHECK_RANGE("worst 5 minute window, 0.01 L/100km", worst.windows[TRIP_WINDOW_5MIN], 0, 1);
+}
+
+
+int main(void) {
+    static const drive DRIVES[] = {
+        {"urban - 50 h of stop and go up to 60 km/h", 50, 10, 60, 5, 60, 0.3},
+        {"motorway - 100 h at 90-140 km/h", 100, 90, 140, 60, 900, 0.01},
+        {"mixed - 400 h, standstill to 250 km/h", 400, 5, 250, 10, 600, 0.1},
+    };
+    int status, failed = 0;
+    uint8_t i;
+
+    // Consumption windows only start over at power up - every drive gets a process of its own
+    for(i = 0; i != sizeof(DRIVES)/sizeof(DRIVES[0]); ++i) {
+        fflush(stdout);
+        if(!fork()) {
+            run(&DRIVES[i]);
+            return testEnd();
+        }
+        wait(&status);
+        failed |= !WIFEXITED(status) || WEXITSTATUS(status);
+    }
+    return failed;
+}
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+#  Universal Board Computer for cars with electronic MPI
+#  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+#
+#  This file is part of UBC.
+#  UBC is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU Affero General Public License as
+#  published by the Free Software Foundation, either version 3 of the
+#  License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#  See the GNU Affero General Public License for more details.
+#
+#  You should have received a copy of the GNU Affero General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+# <https://itcrowd.net.pl/>
+
+# Replays a drive trace through the host build and compares what would be shown, tick by tick,
+# with the output of a known good build. Run `make host` first:
+#   python3 tools/replay.py --update urban.trace urban.golden.csv   # from the known good build
+#   python3 tools/replay.py urban.trace urban.golden.csv            # after a change
+# Exits with 1 when any value is off by more than its tolerance.
+
+import csv
+import os
+import subprocess
+import sys
+import tempfile
+
+HOST = os.path.join(os.path.dirname(__file__), "..", "build", "host", "ubc")
+
+# Column, allowed difference - values in the units they are kept in (km/h, 0.01 L, km, mL)
+TOLERANCE = {"speed": 1, "instant": 10, "average": 5, "range": 2, "fuel": 5}
+
+
+def replay(trace, output):
+    run = subprocess.run([HOST, "-f", trace, "-o", output], stdout=subprocess.PIPE, universal_newlines=True, check=True)
+    sys.stderr.write(run.stdout)
+
+
+def read(path):
+    with open(path) as f:
+        return list(csv.DictReader(f))
+
+
+def main():
+    args = sys.argv[1:]
+    update = "--update" in args
+    if update:
+        args.remove("--update")
+    if len(args) != 2:
+        sys.exit("Usage: replay.py [--update] TRACE GOLDEN")
+    trace, golden = args
+
+    if update:
+        replay(trace, golden)
+        return
+
+    with tempfile.NamedTemporaryFile(suffix=".csv") as out:
+        replay(trace, out.name)
+        now, then = read(out.name), read(golden)
+
+    if len(now) != len(then):
+        print("%d ticks, golden has %d" % (len(now), len(then)))
+        sys.exit(1)
+
+    worst = {column: (0, None) for column in TOLERANCE}
+    failed = 0
+    for a, b in zip(now, then):
+        for column, tolerance in TOLERANCE.items():
+            diff = abs(int(a[column]) - int(b[column]))
+            if diff > worst[column][0]:
+                worst[column] = (diff, a["time"])
+            if diff > tolerance:
+                failed += 1
+                if failed <= 20:
+                    print("%ss %s: %s, golden %s" % (a["time"], column, a[column], b[column]))
+
+    for column, (diff, time) in worst.items():
+        print("%-8s worst %d%s (tolerance %d)" % (column, diff, " at %ss" % time if time else "", TOLERANCE[column]))
+    if failed:
+        print("%d values out of tolerance" % failed)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+#  Universal Board Computer for cars with electronic MPI
+#  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+#
+#  This file is part of UBC.
+#  UBC is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU Affero General Public License as
+#  published by the Free Software Foundation, either version 3 of the
+#  License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#  See the GNU Affero General Public License for more details.
+#
+#  You should have received a copy of the GNU Affero General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+# <https://itcrowd.net.pl/>
+
+# Pre-renders static layer of every screen into `screens.h`, the same way `screenLCDWriteChar()` draws text.
+# Run from the repository root after changing labels below or glyphs in `chars.c`:
+#   python3 tools/screens.py > screens.h
+
+import re
+
+WIDTH, BANKS = 84, 6
+SEPARATOR = "--------------"
+
+# (name, [(x, y, text, scale), ...]) - must match dynamic fields in main.c
+SCREENS = [
+    ("SCREEN_FUEL", [(1, 1, "&$  ", 1), (65, 1, " L", 1), (1, 9, SEPARATOR, 1), (70, 22, "KM", 1),
+                     (1, 32, SEPARATOR, 1), (5, 40, "!\"   ", 1), (70, 40, "L", 1)]),
+    ("SCREEN_SPEED", [(56, 11, "KM/H", 1), (1, 32, SEPARATOR, 1), (5, 40, "#  ", 1), (56, 40, "KM/H", 1)]),
+    ("SCREEN_MAIN", [(1, 1, "$%& ", 1), (65, 1, " KM", 1), (1, 9, SEPARATOR, 1),
+                     (1, 32, SEPARATOR, 1), (5, 40, "#  ", 1), (54, 40, "L/100", 1)]),
+    ("SCREEN_ACCELERATION", [(56, 11, "KM/H", 1), (1, 32, SEPARATOR, 1), (5, 40, "   ", 1), (56, 40, "  S", 1)]),
+    ("SCREEN_SAILING", [(1, 1, "&$  ", 1), (65, 1, " L", 1), (1, 9, SEPARATOR, 1), (55, 22, "KM(S)", 1),
+                        (1, 32, SEPARATOR, 1), (5, 40, "!\"   ", 1), (70, 40, "L", 1)]),
+]
+
+
+def charset():
+    src = open("chars.c").read()
+    body = src[src.index("CHARSET"):]
+    body = body[body.index("{") + 1:body.rindex("}")]
+    glyphs = []
+    for entry in re.findall(r"\{([^}]*)\}", body):
+        columns = [int(v, 16) for v in re.findall(r"0x[0-9a-fA-F]+", entry)]
+        glyphs.append(columns + [0] * (5 - len(columns)))
+    return glyphs
+
+
+def render(labels, glyphs):
+    screen = [0] * (WIDTH * BANKS)
+    for x0, y0, text, scale in labels:
+        cx, cy = x0, y0
+        for ch in text:
+            glyph = glyphs[ord(ch) - 32]
+            for x in range(5 * scale):
+                for y in range(7 * scale):
+                    px, py = cx + x, cy + y
+                    if px >= WIDTH or py >= 8 * BANKS:
+                        continue
+                    i, bit = py // 8 * WIDTH + px, 1 << (py % 8)
+                    if glyph[x // scale] & (1 << (y // scale)):
+                        screen[i] |= bit
+                    else:
+                        screen[i] &= ~bit
+            cx += 5 * scale + 1
+            if cx >= WIDTH:
+                cx, cy = 0, cy + 7 * scale + 1
+            if cy >= 8 * BANKS:
+                cx, cy = 0, 0
+    return screen
+
+
+def main():
+    glyphs = charset()
+    print("// Generated by tools/screens.py from chars.c - do not edit by hand\n")
+    print("// Static layers of the screens - 6 banks of 84 columns, copied in with `memcpy_P()`\n")
+    print("#ifndef SCREENS_H\n#define SCREENS_H\n\n#include <avr/pgmspace.h>\n")
+    for name, labels in SCREENS:
+        screen = render(labels, glyphs)
+        print("const uint8_t %s[%d] PROGMEM = {" % (name, WIDTH * BANKS))
+        for bank in range(BANKS):
+            row = screen[bank * WIDTH:(bank + 1) * WIDTH]
+            for i in range(0, WIDTH, 14):
+                sep = "," if bank != BANKS - 1 or i + 14 < WIDTH else ""
+                print("\t" + ", ".join("0x%02x" % v for v in row[i:i + 14]) + sep)
+        print("};\n")
+    print("#endif  // SCREENS_H")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+#  Universal Board Computer for cars with electronic MPI
+#  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+#
+#  This file is part of UBC.
+#  UBC is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU Affero General Public License as
+#  published by the Free Software Foundation, either version 3 of the
+#  License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#  See the GNU Affero General Public License for more details.
+#
+#  You should have received a copy of the GNU Affero General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+# <https://itcrowd.net.pl/>
+
+# Decodes the USART telemetry of `telem.c` into CSV, one row per frame. Reads a serial port or a capture:
+#   python3 tools/telemetry.py /dev/ttyUSB0 > drive.csv
+#   python3 tools/telemetry.py capture.bin > drive.csv
+# Broken frames and dropped ones are reported on stderr.
+
+import os
+import struct
+import sys
+import termios
+
+BAUD = termios.B500000
+FRAME = struct.Struct("<HBBHIHBH")  # Must match `telemFrame` in telem.h
+COLUMNS = "seq,ticks,dropped,pulses,inj_ticks,speed,flags,adc"
+
+
+def crc_ccitt(data):
+    # Same as avr-libc `_crc_ccitt_update()`, starting from 0xFFFF
+    crc = 0xFFFF
+    for b in data:
+        b ^= crc & 0xFF
+        b = (b ^ (b << 4)) & 0xFF
+        crc = ((b << 8) | (crc >> 8)) ^ (b >> 4) ^ (b << 3)
+    return crc & 0xFFFF
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def open_source(path):
+    fd = os.open(path, os.O_RDONLY | os.O_NOCTTY)
+    if os.isatty(fd):
+        attrs = termios.tcgetattr(fd)
+        attrs[0] = 0                                         # iflag - raw
+        attrs[1] = 0                                         # oflag
+        attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+        attrs[3] = 0                                         # lflag
+        attrs[4] = attrs[5] = BAUD
+        attrs[6][termios.VMIN] = 1
+        attrs[6][termios.VTIME] = 0
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return os.fdopen(fd, "rb", buffering=0)
+
+
+def frames(source):
+    pending = bytearray()
+    while True:
+        chunk = source.read(4096)
+        if not chunk:
+            return
+        pending += chunk
+        while True:
+            end = pending.find(0)
+            if end < 0:
+                break
+            yield bytes(pending[:end])
+            del pending[:end + 1]
+
+
+def main():
+    source = open_source(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin.buffer
+    print(COLUMNS)
+
+    last, bad, lost = None, 0, 0
+    for encoded in frames(source):
+        data = cobs_decode(encoded)
+        if data is None or len(data) != FRAME.size + 2 or crc_ccitt(data[:-2]) != struct.unpack("<H", data[-2:])[0]:
+            bad += 1  # The first one is usually cut in half
+            continue
+
+        row = list(FRAME.unpack(data[:-2]))
+        seq, dropped = row[0], row[2]
+        if last is not None and (seq - last - 1) & 0xFFFF:
+            lost += (seq - last - 1) & 0xFFFF
+            print("seq %d: %d frames missing, device dropped %d" % (seq, (seq - last - 1) & 0xFFFF, dropped), file=sys.stderr)
+        last = seq
+
+        row[5] = "%.1f" % (row[5] / 10)  # km/h
+        print(",".join(str(v) for v in row))
+        sys.stdout.flush()
+
+    print("%d broken frames, %d missing" % (bad, lost), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except KeyboardInterrupt:
+        pass
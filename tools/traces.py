@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+#  Universal Board Computer for cars with electronic MPI
+#  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+#
+#  This file is part of UBC.
+#  UBC is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU Affero General Public License as
+#  published by the Free Software Foundation, either version 3 of the
+#  License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#  See the GNU Affero General Public License for more details.
+#
+#  You should have received a copy of the GNU Affero General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+# <https://itcrowd.net.pl/>
+
+# Writes synthetic drive traces for the host replay (`./build/host/ubc -f`), always the same for a given name:
+#   python3 tools/traces.py urban > urban.trace
+# Format is described at `traceRead()` in host/host.c
+
+import math
+import sys
+
+PULSE_DISTANCE = 0.00006823  # km per VSS pulse - host default calibration
+IDLE_RPM = 800
+GEARS = [(0, 15, 110), (15, 30, 60), (30, 50, 42), (50, 70, 33), (70, 999, 27)]  # km/h range and rpm per km/h
+STEP = 0.01  # s
+
+
+def rpm(speed):
+    if speed < 3:
+        return IDLE_RPM
+    for low, high, ratio in GEARS:
+        if low <= speed < high:
+            return max(IDLE_RPM, speed * ratio)
+
+
+def width(speed, accel, revs):
+    # Injector open time, ms - fuel cut while coasting down in gear
+    if accel < -0.5 and speed > 20:
+        return 0
+    return min(2.0 + max(accel, 0) * 2.5 + speed * 0.012, 0.8 * 120000 / revs)
+
+
+def urban():
+    # Stop and go: 0-50 km/h, cruise, brake, wait at the lights
+    for _ in range(15):
+        yield from ramp(0, 50, 8)
+        yield from hold(50, 30)
+        yield from ramp(50, 0, 6)
+        yield from hold(0, 20)
+
+
+def highway():
+    yield from ramp(0, 120, 20)
+    for i in range(30):
+        yield from hold(120 + 5 * math.sin(i), 55)
+        yield from ramp(120, 90, 5)
+        yield from ramp(90, 120, 10)
+    yield from ramp(120, 0, 25)
+
+
+def idle():
+    yield from hold(0, 600)
+
+
+def ramp(start, end, seconds):
+    n = int(seconds / STEP)
+    for i in range(n):
+        yield start + (end - start) * (i + 1) / n
+
+
+def hold(speed, seconds):
+    for _ in range(int(seconds / STEP)):
+        yield speed
+
+
+PROFILES = {"urban": urban, "highway": highway, "idle": idle}
+
+
+def main():
+    if len(sys.argv) != 2 or sys.argv[1] not in PROFILES:
+        sys.exit("Usage: traces.py " + "|".join(PROFILES))
+
+    out = sys.stdout
+    out.write("# %s drive, %g km per pulse\n0 A 800\n" % (sys.argv[1], PULSE_DISTANCE))
+
+    t, last, distance, next_injection = 0.0, 0.0, 0.0, 0.5
+    events = []
+    for speed in PROFILES[sys.argv[1]]():
+        accel = (speed - last) / STEP / 3.6  # m/s^2
+        distance += speed / 3600 * STEP
+
+        # VSS pulses within this step, spread evenly
+        pulses = int(distance / PULSE_DISTANCE)
+        for p in range(pulses):
+            events.append((t + STEP * (p + 1) / (pulses + 1), "V"))
+        distance -= pulses * PULSE_DISTANCE
+
+        revs = rpm(speed)
+        while next_injection < t + STEP:
+            w = width(speed, accel, revs)
+            if w > 0:
+                events.append((next_injection, "I 1"))
+                events.append((next_injection + w / 1000, "I 0"))
+            next_injection += 120 / revs
+
+        events.sort()
+        while events and events[0][0] < t + STEP:
+            at, what = events.pop(0)
+            out.write("%d %s\n" % (at * 1e6, what))
+
+        t += STEP
+        last = speed
+
+    for at, what in sorted(events):
+        out.write("%d %s\n" % (at * 1e6, what))
+
+
+if __name__ == "__main__":
+    main()
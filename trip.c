@@ -0,0 +1,196 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#include "trip.h"
+
+tripCounters trip;
+tripValues   tripNow;
+
+static uint32_t distPerPulse = 0;     // nm per VSS pulse
+static uint32_t fuelPerTick  = 0;     // pL per injector tick, all injectors together
+static uint64_t fuelDrain    = 0;     // pL burnt, but not yet taken from the tank as a whole mL
+
+#define NM_PER_KM  1000000000000ULL
+#define PL_PER_ML  1000000000ULL
+
+#define SEGMENT_UM 100000000UL        // Shortest segment, 100 m
+#define MINUTE_TICKS (60 * TRIP_TICKS_PER_SECOND)
+
+typedef struct {
+    uint32_t fuel[TRIP_SEGMENTS];     // Injector ticks of every segment
+    uint32_t sum;                     // ... of all of them
+} tripRing;
+
+static struct {
+    tripRing rings[3];                // 1 km, 10 km and 100 km windows
+    uint32_t dist;                    // µm into the current 100 m segment
+    uint32_t fuel;                    // Injector ticks of the current 100 m segment
+    uint32_t minuteFuel[TRIP_MINUTES];
+    uint32_t minutePulses[TRIP_MINUTES];  // A minute at 250 km/h is over 16 bits of 37 µm pulses
+    uint8_t  head[3], filled[3];
+    uint8_t  minute, ticks;
+} windows;
+
+_Static_assert(sizeof(windows) < 200, "Consumption windows don't fit in 200 bytes");
+
+
+// Calibration values: km per VSS pulse and L/s of fuel flow through a single injector
+void tripCalibrate(float pulseDistance, float injectionValue, uint8_t injectors) {
+    // Negated comparisons also catch NaN, which is what erased EEPROM reads as
+    distPerPulse = !(pulseDistance > 0) ? 0 : (uint32_t)(pulseDistance * 1e12f + 0.5f);
+    fuelPerTick  = !(injectionValue > 0) ? 0 : (uint32_t)(injectionValue * (TRIP_TICK_CYCLES * 1e12f / F_CPU) * injectors + 0.5f);
+}
+
+// pL over nm to 0.01 L/100km, 0 for less than a metre
+static uint16_t consumption(uint64_t fuel, uint64_t dist) {
+    uint64_t v;
+
+    if(dist < NM_PER_KM / 1000) return 0;
+    v = fuel / (dist / 10000);
+    return (v > 0xFFFF) ? 0xFFFF : v;
+}
+
+// Averages from the sums - called every second and after the counters are loaded or reset
+void tripAverages(void) {
+    tripNow.avgSpeed = trip.speedInvSum ? ((uint64_t)trip.speedSamples<<32) / trip.speedInvSum : 0;
+    tripNow.avgFuel  = consumption(trip.avgFuelTicks * fuelPerTick, (uint64_t)trip.avgPulses * distPerPulse);
+}
+
+// Finished 100 m segment - it goes into the 1 km ring, and each time a ring goes round,
+// its sum goes into the next one as a single segment
+static void windowsSegment(uint32_t fuel) {
+    register uint8_t i;
+
+    for(i = 0; i != 3; ++i) {
+        tripRing *ring = &windows.rings[i];
+        uint8_t head = windows.head[i];
+
+        ring->sum += fuel - ring->fuel[head];
+        ring->fuel[head] = fuel;
+        if(windows.filled[i] < TRIP_SEGMENTS) ++windows.filled[i];
+
+        if(++head != TRIP_SEGMENTS) {windows.head[i] = head; return;}
+        windows.head[i] = 0;
+        fuel = ring->sum;
+    }
+}
+
+static void windowsUpdate(uint16_t pulses, uint32_t dist, uint32_t injTicks, uint8_t elapsed) {
+    uint32_t fuel = injTicks, share;
+
+    // Fuel is split between segments by distance
+    while(windows.dist + dist >= SEGMENT_UM) {
+        share = (uint64_t)fuel * (SEGMENT_UM - windows.dist) / dist;
+        dist -= SEGMENT_UM - windows.dist;
+        fuel -= share;
+
+        windowsSegment(windows.fuel + share);
+        windows.dist = 0;
+        windows.fuel = 0;
+    }
+    windows.dist += dist;
+    windows.fuel += fuel;
+
+    // Minutes are added up while they last, the oldest one is dropped when a new one starts
+    windows.minutePulses[windows.minute] += pulses;
+    windows.minuteFuel[windows.minute] += injTicks;
+
+    windows.ticks += elapsed;
+    if(windows.ticks < MINUTE_TICKS) return;
+    windows.ticks -= MINUTE_TICKS;
+
+    if(++windows.minute == TRIP_MINUTES) windows.minute = 0;
+    windows.minutePulses[windows.minute] = 0;
+    windows.minuteFuel[windows.minute] = 0;
+}
+
+// Adds VSS pulses and injector ticks counted over `elapsed` TIMER1 ticks, returns mL of fuel taken from the tank
+uint16_t tripUpdate(uint16_t pulses, uint32_t injTicks, uint8_t elapsed) {
+    uint64_t dist = (uint64_t)pulses * distPerPulse;      // nm
+    uint64_t fuel = (uint64_t)injTicks * fuelPerTick;     // pL
+    uint64_t v = dist * 36 * TRIP_TICKS_PER_SECOND / (NM_PER_KM / 100 * elapsed);  // nm/s to km/h
+    uint16_t drained;
+
+    trip.pulses += pulses;
+    trip.fuelTicks += injTicks;
+    trip.avgPulses += pulses;
+    trip.avgFuelTicks += injTicks;
+    if(!injTicks) trip.sailingPulses += pulses;
+    windowsUpdate(pulses, dist / 1000, injTicks, elapsed);
+
+    tripNow.speed = (v > 255) ? 255 : v;
+    if(tripNow.speed > 5) {
+        // pL/nm is L/km - 10^4 of that is 0.01 L/100km
+        v = fuel * 10000 / dist;
+        tripNow.instantFuel = (v > 0xFFFF) ? 0xFFFF : v;
+
+        // Harmonic mean
+        // Thanks to Gabryś "Dragroth" Król we've got now really good solution for average speed and fuel calculations.
+        // His disappointment, when he saw my miserable arithmetic mean, was immeasurable and his day was ruined.
+        // He took matters into his own hands and after few tests he came up with the solution you can see in here.
+        trip.speedInvSum += (1ULL<<32) / tripNow.speed;
+        ++trip.speedSamples;
+    } else {
+        v = fuel * 36 * TRIP_TICKS_PER_SECOND / (PL_PER_ML / 10 * elapsed);  // pL/s to 0.01 L/h
+        tripNow.instantFuel = (v > 0xFFFF) ? 0xFFFF : v;
+    }
+    tripAverages();
+
+    fuelDrain += fuel;
+    drained = fuelDrain / PL_PER_ML;
+    fuelDrain -= (uint64_t)drained * PL_PER_ML;
+
+    return drained;
+}
+
+// Consumption the range is computed from
+uint16_t tripWindow(uint8_t window) {
+    uint64_t segment = SEGMENT_UM * 1000ULL;  // nm
+    uint64_t pulses = 0, fuel = 0;
+    register uint8_t i, ring;
+
+    switch(window) {
+        case TRIP_WINDOW_1KM:
+        case TRIP_WINDOW_10KM:
+        case TRIP_WINDOW_100KM:
+            ring = window - TRIP_WINDOW_1KM;
+            for(i = 0; i != ring; ++i) segment *= TRIP_SEGMENTS;
+            return consumption((uint64_t)windows.rings[ring].sum * fuelPerTick, segment * windows.filled[ring]);
+
+        case TRIP_WINDOW_5MIN:
+            // Summed when shown - the window is read once a frame, minutes are added to every tick
+            for(i = 0; i != TRIP_MINUTES; ++i) {
+                pulses += windows.minutePulses[i];
+                fuel += windows.minuteFuel[i];
+            }
+            if(pulses * distPerPulse < segment) return 0;
+            return consumption(fuel * fuelPerTick, pulses * distPerPulse);
+
+        default: return tripNow.avgFuel;
+    }
+}
+
+
+uint32_t tripMetres(uint64_t pulses) {return pulses * distPerPulse / (NM_PER_KM / 1000);}
+uint32_t tripMillilitres(uint64_t fuelTicks) {return fuelTicks * fuelPerTick / PL_PER_ML;}
+
+uint32_t tripDistance(void) {return tripMetres(trip.pulses);}
+uint32_t tripSailingDistance(void) {return tripMetres(trip.sailingPulses);}
+uint32_t tripFuel(void) {return tripMillilitres(trip.fuelTicks);}
@@ -0,0 +1,73 @@
+//  ​Universal Board Computer for cars with electronic MPI
+//  Copyright © 2021-2022 IT Crowd, Hubert "hkk" Batkiewicz
+// 
+//  This file is part of UBC.
+//  UBC is free software: you can redistribute it and/or modify
+//  ​it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, either version 3 of the
+//  ​License, or (at your option) any later version.
+// 
+//  ​This program is distributed in the hope that it will be useful,
+//  ​but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  ​MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+//  See the ​GNU Affero General Public License for more details.
+// 
+//  ​You should have received a copy of the GNU Affero General Public License
+//  ​along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+// <https://itcrowd.net.pl/>
+
+
+#ifndef TRIP_H
+#define TRIP_H
+
+#include <stdint.h>
+
+// Trip computation in integers - raw sensor counts are accumulated and physical units
+// are derived only when they're shown, with scale factors precomputed from calibration
+// Everything here belongs to the main loop - ISRs only hand over raw counts
+#define TRIP_TICK_CYCLES 64           // Length of one injector tick - injector time is counted in TIMER0 ticks
+#define TRIP_TICKS_PER_SECOND 4       // TIMER1 ticks
+
+// Raw counters, stored in EEPROM as they are
+typedef struct {
+    uint64_t pulses;                  // VSS pulses
+    uint64_t sailingPulses;           // VSS pulses counted while injectors were closed
+    uint64_t fuelTicks;               // Injector open time
+    uint64_t speedInvSum;             // Sum of 1/speed samples, Q32   (harmonic mean of speed)
+    uint64_t avgFuelTicks;            // Injector open time since the average consumption was reset
+    uint32_t speedSamples;
+    uint32_t avgPulses;               // VSS pulses since the average consumption was reset
+} tripCounters;
+
+// Values derived every second
+typedef struct {
+    uint8_t  speed;                   // km/h
+    uint8_t  avgSpeed;                // km/h
+    uint16_t instantFuel;             // 0.01 L/100km while moving, 0.01 L/h while standing
+    uint16_t avgFuel;                 // 0.01 L/100km, all fuel over all distance
+} tripValues;
+
+// Rolling consumption windows - distance ones are rings of TRIP_SEGMENTS segments, each window's
+// segment is one whole turn of the previous ring. The time window adds up minutes of fuel and pulses
+// Only kept in RAM, they start over after power up
+#define TRIP_SEGMENTS 10              // 100 m, 1 km and 10 km segments
+#define TRIP_MINUTES  6               // Finished minutes and the current one
+
+enum {TRIP_WINDOW_TRIP, TRIP_WINDOW_1KM, TRIP_WINDOW_10KM, TRIP_WINDOW_100KM, TRIP_WINDOW_5MIN, TRIP_WINDOWS};
+
+extern tripCounters trip;
+extern tripValues   tripNow;
+
+void tripCalibrate(float pulseDistance, float injectionValue, uint8_t injectors);
+void tripAverages(void);
+uint16_t tripUpdate(uint16_t pulses, uint32_t injTicks, uint8_t elapsed);
+uint16_t tripWindow(uint8_t window);  // 0.01 L/100km, 0 until the window has seen enough distance
+
+uint32_t tripMetres(uint64_t pulses);
+uint32_t tripMillilitres(uint64_t fuelTicks);
+uint32_t tripDistance(void);
+uint32_t tripSailingDistance(void);
+uint32_t tripFuel(void);
+
+#endif  // TRIP_H